@@ -0,0 +1,582 @@
+#ifndef _JRD_ALGO_H
+#define _JRD_ALGO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "vector.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JRD_ALGO_X86 1
+#include <immintrin.h>
+#endif
+
+
+/*
+ *
+ * Explicitly vectorized algorithms over jrd::vector
+ *
+ * Each algorithm walks the vector one segment (populated block prefix) at
+ * a time and hands the contiguous run to a kernel. Kernels exist for
+ * std::uint64_t and double in three flavours, AVX2, SSE2 and scalar, the
+ * widest one the cpu supports is picked once at runtime. Every other T
+ * goes through the scalar kernels which are still plain pointer loops.
+ *
+ * Floating point sums are accumulated in several lanes, so the result can
+ * differ from a left to right std::accumulate in the last bits.
+ *
+ */
+
+
+namespace jrd{
+namespace algo{
+
+enum class isa { scalar, sse2, avx2 };
+
+namespace detail{
+
+inline isa detect_isa() noexcept {
+#ifdef JRD_ALGO_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return isa::avx2;
+    if (__builtin_cpu_supports("sse2")) return isa::sse2;
+#endif
+    return isa::scalar;
+}
+
+inline isa & current_isa() noexcept {
+    static isa level = detect_isa();
+    return level;
+}
+
+/*
+ *
+ * scalar kernels, also the fallback for any T without simd kernels
+ *
+ */
+
+template <typename T>
+inline T sum_scalar(const T * p, size_t n, T acc) {
+    for (size_t i = 0; i < n; ++i) acc += p[i];
+    return acc;
+}
+
+template <typename T>
+inline T min_scalar(const T * p, size_t n, T acc) {
+    for (size_t i = 0; i < n; ++i) acc = p[i] < acc ? p[i] : acc;
+    return acc;
+}
+
+template <typename T>
+inline T max_scalar(const T * p, size_t n, T acc) {
+    for (size_t i = 0; i < n; ++i) acc = acc < p[i] ? p[i] : acc;
+    return acc;
+}
+
+template <typename T>
+inline size_t find_scalar(const T * p, size_t n, const T & val) {
+    for (size_t i = 0; i < n; ++i) if (p[i] == val) return i;
+    return n;
+}
+
+template <typename T>
+inline size_t count_scalar(const T * p, size_t n, const T & val) {
+    size_t c = 0;
+    for (size_t i = 0; i < n; ++i) c += (p[i] == val);
+    return c;
+}
+
+template <typename T>
+inline void fill_scalar(T * p, size_t n, const T & val) {
+    std::fill(p, p + n, val);
+}
+
+#ifdef JRD_ALGO_X86
+
+/*
+ *
+ * SSE2 kernels, SSE2 has no 64 bit integer compare so uint64 equality is
+ * built from the 32 bit one and uint64 min/max stay scalar
+ *
+ */
+
+__attribute__((target("sse2")))
+inline std::uint64_t sum_sse2(const std::uint64_t * p, size_t n, std::uint64_t acc) {
+    __m128i a0 = _mm_setzero_si128();
+    __m128i a1 = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        a0 = _mm_add_epi64(a0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)));
+        a1 = _mm_add_epi64(a1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 2)));
+    }
+    alignas(16) std::uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), _mm_add_epi64(a0, a1));
+    return sum_scalar(p + i, n - i, acc + lanes[0] + lanes[1]);
+}
+
+__attribute__((target("sse2")))
+inline double sum_sse2(const double * p, size_t n, double acc) {
+    __m128d a0 = _mm_setzero_pd();
+    __m128d a1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        a0 = _mm_add_pd(a0, _mm_loadu_pd(p + i));
+        a1 = _mm_add_pd(a1, _mm_loadu_pd(p + i + 2));
+    }
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, _mm_add_pd(a0, a1));
+    return sum_scalar(p + i, n - i, acc + lanes[0] + lanes[1]);
+}
+
+__attribute__((target("sse2")))
+inline double min_sse2(const double * p, size_t n, double acc) {
+    __m128d m = _mm_set1_pd(acc);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) m = _mm_min_pd(_mm_loadu_pd(p + i), m);
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, m);
+    return min_scalar(p + i, n - i, std::min(lanes[0], lanes[1]));
+}
+
+__attribute__((target("sse2")))
+inline double max_sse2(const double * p, size_t n, double acc) {
+    __m128d m = _mm_set1_pd(acc);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) m = _mm_max_pd(_mm_loadu_pd(p + i), m);
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, m);
+    return max_scalar(p + i, n - i, std::max(lanes[0], lanes[1]));
+}
+
+// all ones in every 64 bit lane that matched
+__attribute__((target("sse2")))
+inline __m128i eq_lanes_sse2(const std::uint64_t * p, __m128i v) {
+    // a lane matches when both of its 32 bit halves do, swap the halves and and them together
+    const __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), v);
+    return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("sse2")))
+inline __m128i eq_lanes_sse2(const double * p, __m128d v) {
+    return _mm_castpd_si128(_mm_cmpeq_pd(_mm_loadu_pd(p), v));
+}
+
+// bit k of the result is set when 64 bit lane k matched
+template <typename T, typename V>
+__attribute__((target("sse2")))
+inline int eq_mask_sse2(const T * p, V v) {
+    return _mm_movemask_pd(_mm_castsi128_pd(eq_lanes_sse2(p, v)));
+}
+
+__attribute__((target("sse2")))
+inline size_t find_sse2(const std::uint64_t * p, size_t n, const std::uint64_t & val) {
+    const __m128i v = _mm_set1_epi64x(static_cast<long long>(val));
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2){
+        const int m = eq_mask_sse2(p + i, v);
+        if (m) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(m)));
+    }
+    return i + find_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("sse2")))
+inline size_t find_sse2(const double * p, size_t n, const double & val) {
+    const __m128d v = _mm_set1_pd(val);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2){
+        const int m = eq_mask_sse2(p + i, v);
+        if (m) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(m)));
+    }
+    return i + find_scalar(p + i, n - i, val);
+}
+
+// matched lanes are all ones, i.e. -1, so subtracting them counts matches
+__attribute__((target("sse2")))
+inline size_t count_sse2(const std::uint64_t * p, size_t n, const std::uint64_t & val) {
+    const auto v = _mm_set1_epi64x(static_cast<long long>(val));
+    __m128i c = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) c = _mm_sub_epi64(c, eq_lanes_sse2(p + i, v));
+    alignas(16) std::uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), c);
+    return lanes[0] + lanes[1] + count_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("sse2")))
+inline size_t count_sse2(const double * p, size_t n, const double & val) {
+    const auto v = _mm_set1_pd(val);
+    __m128i c = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) c = _mm_sub_epi64(c, eq_lanes_sse2(p + i, v));
+    alignas(16) std::uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), c);
+    return lanes[0] + lanes[1] + count_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("sse2")))
+inline void fill_sse2(std::uint64_t * p, size_t n, const std::uint64_t & val) {
+    const __m128i v = _mm_set1_epi64x(static_cast<long long>(val));
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), v);
+    fill_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("sse2")))
+inline void fill_sse2(double * p, size_t n, const double & val) {
+    const __m128d v = _mm_set1_pd(val);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(p + i, v);
+    fill_scalar(p + i, n - i, val);
+}
+
+/*
+ *
+ * AVX2 kernels, unsigned 64 bit compares flip the sign bit and use the
+ * signed compare since AVX2 has no unsigned one
+ *
+ */
+
+__attribute__((target("avx2")))
+inline std::uint64_t sum_avx2(const std::uint64_t * p, size_t n, std::uint64_t acc) {
+    __m256i a0 = _mm256_setzero_si256();
+    __m256i a1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        a0 = _mm256_add_epi64(a0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)));
+        a1 = _mm256_add_epi64(a1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i + 4)));
+    }
+    alignas(32) std::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(a0, a1));
+    return sum_scalar(p + i, n - i, acc + lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+__attribute__((target("avx2")))
+inline double sum_avx2(const double * p, size_t n, double acc) {
+    __m256d a0 = _mm256_setzero_pd();
+    __m256d a1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        a0 = _mm256_add_pd(a0, _mm256_loadu_pd(p + i));
+        a1 = _mm256_add_pd(a1, _mm256_loadu_pd(p + i + 4));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(a0, a1));
+    return sum_scalar(p + i, n - i, acc + ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])));
+}
+
+__attribute__((target("avx2")))
+inline __m256i flip_sign_avx2(__m256i v) {
+    return _mm256_xor_si256(v, _mm256_set1_epi64x(std::numeric_limits<long long>::min()));
+}
+
+__attribute__((target("avx2")))
+inline std::uint64_t min_avx2(const std::uint64_t * p, size_t n, std::uint64_t acc) {
+    __m256i m = flip_sign_avx2(_mm256_set1_epi64x(static_cast<long long>(acc)));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        const __m256i x = flip_sign_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)));
+        m = _mm256_blendv_epi8(m, x, _mm256_cmpgt_epi64(m, x));
+    }
+    alignas(32) std::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), flip_sign_avx2(m));
+    return min_scalar(p + i, n - i, min_scalar(lanes, 4, lanes[0]));
+}
+
+__attribute__((target("avx2")))
+inline std::uint64_t max_avx2(const std::uint64_t * p, size_t n, std::uint64_t acc) {
+    __m256i m = flip_sign_avx2(_mm256_set1_epi64x(static_cast<long long>(acc)));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        const __m256i x = flip_sign_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)));
+        m = _mm256_blendv_epi8(m, x, _mm256_cmpgt_epi64(x, m));
+    }
+    alignas(32) std::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), flip_sign_avx2(m));
+    return max_scalar(p + i, n - i, max_scalar(lanes, 4, lanes[0]));
+}
+
+__attribute__((target("avx2")))
+inline double min_avx2(const double * p, size_t n, double acc) {
+    __m256d m = _mm256_set1_pd(acc);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) m = _mm256_min_pd(_mm256_loadu_pd(p + i), m);
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, m);
+    return min_scalar(p + i, n - i, min_scalar(lanes, 4, lanes[0]));
+}
+
+__attribute__((target("avx2")))
+inline double max_avx2(const double * p, size_t n, double acc) {
+    __m256d m = _mm256_set1_pd(acc);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) m = _mm256_max_pd(_mm256_loadu_pd(p + i), m);
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, m);
+    return max_scalar(p + i, n - i, max_scalar(lanes, 4, lanes[0]));
+}
+
+__attribute__((target("avx2")))
+inline __m256i eq_lanes_avx2(const std::uint64_t * p, __m256i v) {
+    return _mm256_cmpeq_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), v);
+}
+
+__attribute__((target("avx2")))
+inline __m256i eq_lanes_avx2(const double * p, __m256d v) {
+    return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_loadu_pd(p), v, _CMP_EQ_OQ));
+}
+
+template <typename T, typename V>
+__attribute__((target("avx2")))
+inline int eq_mask_avx2(const T * p, V v) {
+    return _mm256_movemask_pd(_mm256_castsi256_pd(eq_lanes_avx2(p, v)));
+}
+
+__attribute__((target("avx2")))
+inline size_t find_avx2(const std::uint64_t * p, size_t n, const std::uint64_t & val) {
+    const __m256i v = _mm256_set1_epi64x(static_cast<long long>(val));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        const int m = eq_mask_avx2(p + i, v);
+        if (m) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(m)));
+    }
+    return i + find_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("avx2")))
+inline size_t find_avx2(const double * p, size_t n, const double & val) {
+    const __m256d v = _mm256_set1_pd(val);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        const int m = eq_mask_avx2(p + i, v);
+        if (m) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(m)));
+    }
+    return i + find_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("avx2")))
+inline size_t count_avx2(const std::uint64_t * p, size_t n, const std::uint64_t & val) {
+    const auto v = _mm256_set1_epi64x(static_cast<long long>(val));
+    __m256i c = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) c = _mm256_sub_epi64(c, eq_lanes_avx2(p + i, v));
+    alignas(32) std::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), c);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + count_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("avx2")))
+inline size_t count_avx2(const double * p, size_t n, const double & val) {
+    const auto v = _mm256_set1_pd(val);
+    __m256i c = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) c = _mm256_sub_epi64(c, eq_lanes_avx2(p + i, v));
+    alignas(32) std::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), c);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + count_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("avx2")))
+inline void fill_avx2(std::uint64_t * p, size_t n, const std::uint64_t & val) {
+    const __m256i v = _mm256_set1_epi64x(static_cast<long long>(val));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i), v);
+    fill_scalar(p + i, n - i, val);
+}
+
+__attribute__((target("avx2")))
+inline void fill_avx2(double * p, size_t n, const double & val) {
+    const __m256d v = _mm256_set1_pd(val);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(p + i, v);
+    fill_scalar(p + i, n - i, val);
+}
+
+#endif // JRD_ALGO_X86
+
+/*
+ *
+ * dispatch, the generic templates are the fallback for every T and the
+ * overloads pick a kernel for the types that have simd ones
+ *
+ */
+
+template <typename T>
+inline T sum(const T * p, size_t n, T acc) { return sum_scalar(p, n, acc); }
+template <typename T>
+inline T min(const T * p, size_t n, T acc) { return min_scalar(p, n, acc); }
+template <typename T>
+inline T max(const T * p, size_t n, T acc) { return max_scalar(p, n, acc); }
+template <typename T>
+inline size_t find(const T * p, size_t n, const T & val) { return find_scalar(p, n, val); }
+template <typename T>
+inline size_t count(const T * p, size_t n, const T & val) { return count_scalar(p, n, val); }
+template <typename T>
+inline void fill(T * p, size_t n, const T & val) { fill_scalar(p, n, val); }
+
+#ifdef JRD_ALGO_X86
+
+#define JRD_ALGO_DISPATCH(kernel, avx2_kernel, sse2_kernel, ...) \
+    switch (current_isa()){ \
+        case isa::avx2: return avx2_kernel(__VA_ARGS__); \
+        case isa::sse2: return sse2_kernel(__VA_ARGS__); \
+        default: return kernel(__VA_ARGS__); \
+    }
+
+inline std::uint64_t sum(const std::uint64_t * p, size_t n, std::uint64_t acc) { JRD_ALGO_DISPATCH(sum_scalar, sum_avx2, sum_sse2, p, n, acc) }
+inline double sum(const double * p, size_t n, double acc) { JRD_ALGO_DISPATCH(sum_scalar, sum_avx2, sum_sse2, p, n, acc) }
+inline std::uint64_t min(const std::uint64_t * p, size_t n, std::uint64_t acc) { JRD_ALGO_DISPATCH(min_scalar, min_avx2, min_scalar, p, n, acc) }
+inline double min(const double * p, size_t n, double acc) { JRD_ALGO_DISPATCH(min_scalar, min_avx2, min_sse2, p, n, acc) }
+inline std::uint64_t max(const std::uint64_t * p, size_t n, std::uint64_t acc) { JRD_ALGO_DISPATCH(max_scalar, max_avx2, max_scalar, p, n, acc) }
+inline double max(const double * p, size_t n, double acc) { JRD_ALGO_DISPATCH(max_scalar, max_avx2, max_sse2, p, n, acc) }
+inline size_t find(const std::uint64_t * p, size_t n, const std::uint64_t & val) { JRD_ALGO_DISPATCH(find_scalar, find_avx2, find_sse2, p, n, val) }
+inline size_t find(const double * p, size_t n, const double & val) { JRD_ALGO_DISPATCH(find_scalar, find_avx2, find_sse2, p, n, val) }
+inline size_t count(const std::uint64_t * p, size_t n, const std::uint64_t & val) { JRD_ALGO_DISPATCH(count_scalar, count_avx2, count_sse2, p, n, val) }
+inline size_t count(const double * p, size_t n, const double & val) { JRD_ALGO_DISPATCH(count_scalar, count_avx2, count_sse2, p, n, val) }
+inline void fill(std::uint64_t * p, size_t n, const std::uint64_t & val) { JRD_ALGO_DISPATCH(fill_scalar, fill_avx2, fill_sse2, p, n, val) }
+inline void fill(double * p, size_t n, const double & val) { JRD_ALGO_DISPATCH(fill_scalar, fill_avx2, fill_sse2, p, n, val) }
+
+#undef JRD_ALGO_DISPATCH
+
+#endif // JRD_ALGO_X86
+
+} // namespace detail
+
+
+// widest instruction set the kernels are currently using
+inline isa active_isa() noexcept {
+    return detail::current_isa();
+}
+
+// restrict the kernels to level, requests above what the cpu supports are clamped
+inline void set_isa(isa level) noexcept {
+    const isa supported = detail::detect_isa();
+    detail::current_isa() = static_cast<int>(level) < static_cast<int>(supported) ? level : supported;
+}
+
+
+template <typename T, typename Allocator, typename Policy>
+T accumulate(const vector<T, Allocator, Policy> &vec, T init) {
+    vec.for_each_segment([&](typename vector<T, Allocator, Policy>::const_segment seg){
+        init = detail::sum(seg.data(), seg.size(), init);
+    });
+    return init;
+}
+
+template <typename T, typename Allocator, typename Policy>
+T min(const vector<T, Allocator, Policy> &vec) {
+    if (vec.empty()) throw std::out_of_range("no elements in jrd::vector");
+    T result = vec[0];
+    vec.for_each_segment([&](typename vector<T, Allocator, Policy>::const_segment seg){
+        result = detail::min(seg.data(), seg.size(), result);
+    });
+    return result;
+}
+
+template <typename T, typename Allocator, typename Policy>
+T max(const vector<T, Allocator, Policy> &vec) {
+    if (vec.empty()) throw std::out_of_range("no elements in jrd::vector");
+    T result = vec[0];
+    vec.for_each_segment([&](typename vector<T, Allocator, Policy>::const_segment seg){
+        result = detail::max(seg.data(), seg.size(), result);
+    });
+    return result;
+}
+
+// index of the first element equal to val, vec.size() if there is none
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::size_type find_index(const vector<T, Allocator, Policy> &vec, const T &val) {
+    typename vector<T, Allocator, Policy>::size_type base = 0;
+    for (auto seg : vec.segments()){
+        const size_t i = detail::find(seg.data(), seg.size(), val);
+        if (i != seg.size()) return base + i;
+        base += seg.size();
+    }
+    return base;
+}
+
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::iterator find(vector<T, Allocator, Policy> &vec, const T &val) {
+    return vec.begin() + static_cast<typename vector<T, Allocator, Policy>::difference_type>(find_index(vec, val));
+}
+
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_iterator find(const vector<T, Allocator, Policy> &vec, const T &val) {
+    return vec.cbegin() + static_cast<typename vector<T, Allocator, Policy>::difference_type>(find_index(vec, val));
+}
+
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::size_type count(const vector<T, Allocator, Policy> &vec, const T &val) {
+    typename vector<T, Allocator, Policy>::size_type n = 0;
+    vec.for_each_segment([&](typename vector<T, Allocator, Policy>::const_segment seg){
+        n += detail::count(seg.data(), seg.size(), val);
+    });
+    return n;
+}
+
+// branch free per segment so the compiler can vectorize simple predicates
+template <typename T, typename Allocator, typename Policy, class Predicate>
+typename vector<T, Allocator, Policy>::size_type count_if(const vector<T, Allocator, Policy> &vec, Predicate pred) {
+    typename vector<T, Allocator, Policy>::size_type n = 0;
+    vec.for_each_segment([&](typename vector<T, Allocator, Policy>::const_segment seg){
+        const T * p = seg.data();
+        const size_t len = seg.size();
+        size_t c = 0;
+        for (size_t i = 0; i < len; ++i) c += pred(p[i]) ? size_t(1) : size_t(0);
+        n += c;
+    });
+    return n;
+}
+
+template <typename T, typename Allocator, typename Policy>
+void fill(vector<T, Allocator, Policy> &vec, const T &val) {
+    vec.for_each_segment([&](typename vector<T, Allocator, Policy>::segment seg){
+        detail::fill(seg.data(), seg.size(), val);
+    });
+}
+
+// in place, vec[i] = op(vec[i])
+template <typename T, typename Allocator, typename Policy, class UnaryOp>
+void transform(vector<T, Allocator, Policy> &vec, UnaryOp op) {
+    vec.for_each_segment([&](typename vector<T, Allocator, Policy>::segment seg){
+        T * p = seg.data();
+        const size_t len = seg.size();
+        for (size_t i = 0; i < len; ++i) p[i] = op(p[i]);
+    });
+}
+
+/*
+ * dst[i] = op(src[i]), the two vectors may have different policies and
+ * so different block layouts, the segments of both are walked side by
+ * side and every run between two block ends is a plain loop
+ */
+template <typename T, typename Allocator, typename Policy, typename U, typename AllocatorU, typename PolicyU, class UnaryOp>
+void transform(const vector<T, Allocator, Policy> &src, vector<U, AllocatorU, PolicyU> &dst, UnaryOp op) {
+    if (src.size() != dst.size()) throw std::length_error("jrd::algo::transform size mismatch");
+    auto out = dst.segments().begin();
+    U * q = nullptr;
+    size_t room = 0;
+    for (auto seg : src.segments()){
+        const T * p = seg.data();
+        size_t len = seg.size();
+        while (len > 0){
+            if (room == 0){
+                q = (*out).data();
+                room = (*out).size();
+                ++out;
+            }
+            const size_t k = len < room ? len : room;
+            for (size_t i = 0; i < k; ++i) q[i] = op(p[i]);
+            p += k;
+            q += k;
+            len -= k;
+            room -= k;
+        }
+    }
+}
+
+} // namespace algo
+} // namespace jrd
+
+#endif
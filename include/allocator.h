@@ -0,0 +1,279 @@
+#ifndef _JRD_ALLOCATOR_H
+#define _JRD_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+
+
+/*
+ *
+ * Allocators for jrd::vector blocks
+ *
+ * block_pool keeps one free list per power of two size class. jrd::vector
+ * asks for blocks of 16, 16, 32, 64, ... elements, so once one vector has
+ * been built and cleared the next one of the same shape is served
+ * entirely from the free lists. Requests are rounded up to the next power
+ * of two bytes, which is exact whenever sizeof(T) is a power of two.
+ *
+ * monotonic_arena hands out memory by bumping a pointer through chunks
+ * it never gives back until release() or destruction, for vectors that
+ * all die together at the end of a request. release() keeps the largest
+ * chunk so the next request reuses it.
+ *
+ * pool_allocator and arena_allocator are the standard allocator front
+ * ends, e.g. jrd::vector<size_t, jrd::pool_allocator<size_t>>.
+ *
+ */
+
+
+namespace jrd{
+
+class block_pool {
+    public:
+        typedef size_t size_type;
+
+        block_pool() noexcept;
+        block_pool(const block_pool &) = delete;
+        block_pool & operator = (const block_pool &) = delete;
+        ~block_pool();
+
+        void * allocate(size_type bytes);
+        void deallocate(void * p, size_type bytes) noexcept;
+
+        // hand every cached block back to the system
+        void release() noexcept;
+        size_type cached_bytes() const noexcept;
+
+        static block_pool & default_pool();
+
+    private:
+        struct free_node {
+            free_node * next;
+        };
+
+        static constexpr size_type num_classes = std::numeric_limits<size_type>::digits;
+
+        mutable std::mutex lock;
+        free_node * free_lists[num_classes];
+        size_type cached;
+
+        static inline size_type size_class(size_type bytes) noexcept;
+};
+
+
+class monotonic_arena {
+    public:
+        typedef size_t size_type;
+
+        explicit monotonic_arena(size_type initial_bytes = size_type(64) << 10) noexcept;
+        monotonic_arena(const monotonic_arena &) = delete;
+        monotonic_arena & operator = (const monotonic_arena &) = delete;
+        ~monotonic_arena();
+
+        void * allocate(size_type bytes, size_type align);
+
+        // all memory handed out so far becomes invalid, the largest chunk is kept for reuse
+        void release() noexcept;
+        size_type allocated_bytes() const noexcept;
+
+    private:
+        struct chunk {
+            chunk * prev;
+            size_type size;
+        };
+
+        chunk * head;
+        char * cur;
+        char * end;
+        size_type next_size;
+        size_type total;
+};
+
+
+template <typename T>
+class pool_allocator {
+    public:
+        typedef T value_type;
+
+        pool_allocator() noexcept : pool(&block_pool::default_pool()) {}
+        explicit pool_allocator(block_pool &in_pool) noexcept : pool(&in_pool) {}
+        template <typename U>
+        pool_allocator(const pool_allocator<U> &other) noexcept : pool(other.pool) {}
+
+        T * allocate(size_t n) {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "jrd::pool_allocator does not support over aligned types");
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+            return static_cast<T *>(pool->allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T * p, size_t n) noexcept {
+            pool->deallocate(p, n * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator == (const pool_allocator<U> &rhs) const noexcept { return pool == rhs.pool; }
+        template <typename U>
+        bool operator != (const pool_allocator<U> &rhs) const noexcept { return pool != rhs.pool; }
+
+    private:
+        template <typename U> friend class pool_allocator;
+
+        block_pool * pool;
+};
+
+
+template <typename T>
+class arena_allocator {
+    public:
+        typedef T value_type;
+
+        explicit arena_allocator(monotonic_arena &in_arena) noexcept : arena(&in_arena) {}
+        template <typename U>
+        arena_allocator(const arena_allocator<U> &other) noexcept : arena(other.arena) {}
+
+        T * allocate(size_t n) {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+            return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        // memory comes back all at once when the arena is released
+        void deallocate(T *, size_t) noexcept {}
+
+        template <typename U>
+        bool operator == (const arena_allocator<U> &rhs) const noexcept { return arena == rhs.arena; }
+        template <typename U>
+        bool operator != (const arena_allocator<U> &rhs) const noexcept { return arena != rhs.arena; }
+
+    private:
+        template <typename U> friend class arena_allocator;
+
+        monotonic_arena * arena;
+};
+
+
+/*
+ *
+ * block_pool member functions
+ *
+ */
+
+inline block_pool::block_pool() noexcept : lock(), free_lists(), cached(0) {}
+
+inline block_pool::~block_pool() {
+    release();
+}
+
+// smallest c with (1 << c) >= bytes, never smaller than a free_node
+inline block_pool::size_type block_pool::size_class(size_type bytes) noexcept {
+    if (bytes <= sizeof(free_node)) bytes = sizeof(free_node);
+    constexpr size_type top_bit = static_cast<size_type>(std::numeric_limits<unsigned long long>::digits - 1);
+    const size_type msb = top_bit - static_cast<size_type>(__builtin_clzll(bytes));
+    return (bytes & (bytes - 1)) == 0 ? msb : msb + 1;
+}
+
+inline void * block_pool::allocate(size_type bytes) {
+    const size_type c = size_class(bytes);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        free_node * node = free_lists[c];
+        if (node != nullptr){
+            free_lists[c] = node->next;
+            cached -= size_type(1) << c;
+            return node;
+        }
+    }
+    return ::operator new(size_type(1) << c);
+}
+
+inline void block_pool::deallocate(void * p, size_type bytes) noexcept {
+    if (p == nullptr) return;
+    const size_type c = size_class(bytes);
+    free_node * node = static_cast<free_node *>(p);
+    std::lock_guard<std::mutex> guard(lock);
+    node->next = free_lists[c];
+    free_lists[c] = node;
+    cached += size_type(1) << c;
+}
+
+inline void block_pool::release() noexcept {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto &head : free_lists){
+        while (head != nullptr){
+            free_node * next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+    }
+    cached = 0;
+}
+
+inline block_pool::size_type block_pool::cached_bytes() const noexcept {
+    std::lock_guard<std::mutex> guard(lock);
+    return cached;
+}
+
+inline block_pool & block_pool::default_pool() {
+    static block_pool pool;
+    return pool;
+}
+
+
+/*
+ *
+ * monotonic_arena member functions
+ *
+ */
+
+inline monotonic_arena::monotonic_arena(size_type initial_bytes) noexcept
+    : head(nullptr), cur(nullptr), end(nullptr), next_size(initial_bytes == 0 ? 1 : initial_bytes), total(0) {}
+
+inline monotonic_arena::~monotonic_arena() {
+    release();
+    if (head != nullptr) ::operator delete(head);
+}
+
+inline void * monotonic_arena::allocate(size_type bytes, size_type align) {
+    std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(cur) + (align - 1)) & ~(align - 1);
+    if (cur == nullptr || p + bytes > reinterpret_cast<std::uintptr_t>(end)){
+        // chunks double so a growing vector needs O(log n) of them
+        const size_type need = bytes + align + sizeof(chunk);
+        while (next_size < need) next_size *= 2;
+        chunk * c = static_cast<chunk *>(::operator new(next_size));
+        c->prev = head;
+        c->size = next_size;
+        head = c;
+        cur = reinterpret_cast<char *>(c + 1);
+        end = reinterpret_cast<char *>(c) + next_size;
+        next_size *= 2;
+        p = (reinterpret_cast<std::uintptr_t>(cur) + (align - 1)) & ~(align - 1);
+    }
+    cur = reinterpret_cast<char *>(p + bytes);
+    total += bytes;
+    return reinterpret_cast<void *>(p);
+}
+
+// the newest chunk is also the largest, keep it so the next round of
+// allocations starts on memory that is already mapped
+inline void monotonic_arena::release() noexcept {
+    if (head == nullptr) return;
+    while (head->prev != nullptr){
+        chunk * prev = head->prev;
+        head->prev = prev->prev;
+        ::operator delete(prev);
+    }
+    cur = reinterpret_cast<char *>(head + 1);
+    end = reinterpret_cast<char *>(head) + head->size;
+    next_size = head->size * 2;
+    total = 0;
+}
+
+inline monotonic_arena::size_type monotonic_arena::allocated_bytes() const noexcept {
+    return total;
+}
+
+} // namespace jrd
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef _JRD_CONCURRENT_VECTOR_H
+#define _JRD_CONCURRENT_VECTOR_H
+
+#include <cstddef>
+#include <atomic>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include "growth_policy.h"
+
+
+/*
+ *
+ * Append only vector that many threads can grow at once
+ *
+ * Same block layout as jrd::vector, 16, 16, 32, 64, ... elements (the
+ * index math is doubling_growth<>'s), with a fixed directory of atomic
+ * block pointers sized for every block a size_type index can reach.
+ * Appending reserves indices with a single fetch_add, a missing block is
+ * allocated by whoever needs it first and installed with a compare and
+ * swap, the losers free their copy. Nothing ever moves so every index and
+ * reference handed out stays valid for the life of the vector.
+ *
+ * size() counts reserved slots, an element may still be under
+ * construction until the push_back that returned its index has returned.
+ * Reading index i is safe for any thread that knows the push of i has
+ * finished (it made the push, or synchronized with the thread that did).
+ * Destruction and clear() need exclusive access.
+ *
+ * A slot is counted before its element is built, so a constructor that
+ * throws leaves a hole in the vector. Every block carries one flag per
+ * slot that is set once the element is built: clear() only destroys
+ * flagged slots, and at() throws on a hole where operator[] must not be
+ * used.
+ *
+ */
+
+
+namespace jrd{
+
+template <typename T>
+class concurrent_vector {
+    public:
+        typedef T                                     value_type;
+        typedef T &                                   reference;
+        typedef const T &                             const_reference;
+        typedef T *                                   pointer;
+        typedef const T *                             const_pointer;
+        typedef ptrdiff_t                             difference_type;
+        typedef size_t                                size_type;
+
+        concurrent_vector() noexcept;
+        concurrent_vector(const concurrent_vector<T> &) = delete;
+        concurrent_vector<T> & operator = (const concurrent_vector<T> &) = delete;
+        ~concurrent_vector();
+
+
+        bool empty() const noexcept;
+        size_type size() const noexcept;
+        size_type capacity() const noexcept;
+
+
+        reference operator [](size_type) noexcept;
+        const_reference operator [](size_type) const noexcept;
+        reference at(size_type);
+        const_reference at(size_type) const;
+
+
+        // all return the index of the (first) new element
+        template <class ... Args>
+        size_type emplace_back(Args && ... args);
+        size_type push_back(const T &);
+        size_type push_back(T &&);
+        size_type grow_by(size_type n);
+        size_type grow_by(size_type n, const T &val);
+
+
+        void clear() noexcept;
+
+    private:
+        typedef doubling_growth<> layout;
+        typedef block_location location_type;
+
+        static constexpr size_type max_blocks = layout::max_blocks;
+
+        std::atomic<size_type> num_reserved;
+        std::atomic<T *> blocks[max_blocks];
+
+        static inline location_type locate(size_type idx) noexcept { return layout::locate(idx); }
+        static constexpr size_type block_start(size_type block) noexcept { return layout::block_start(block); }
+        static constexpr size_type block_size(size_type block) noexcept { return layout::block_size(block); }
+        static T * allocate_storage(size_type sz);
+        static void deallocate_storage(T * data) noexcept;
+        static inline std::atomic<bool> * built_flags(T * data, size_type block) noexcept;
+        inline bool is_built(size_type idx) const noexcept;
+        inline T * slot(size_type idx) const noexcept;
+        T * install_block(size_type block);
+        void ensure_blocks(size_type first, size_type last);
+        template <class ... Args>
+        void construct_at(size_type idx, Args && ... args);
+};
+
+
+template <typename T>
+concurrent_vector<T>::concurrent_vector() noexcept : num_reserved(0) {
+    for (auto &b : blocks) b.store(nullptr, std::memory_order_relaxed);
+}
+
+template <typename T>
+concurrent_vector<T>::~concurrent_vector() {
+    clear();
+}
+
+template <typename T>
+bool concurrent_vector<T>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename T>
+typename concurrent_vector<T>::size_type concurrent_vector<T>::size() const noexcept {
+    return num_reserved.load(std::memory_order_acquire);
+}
+
+template <typename T>
+typename concurrent_vector<T>::size_type concurrent_vector<T>::capacity() const noexcept {
+    size_type total = 0;
+    for (size_type b = 0; b < max_blocks; ++b){
+        // blocks can be installed out of order, so look at all of them
+        if (blocks[b].load(std::memory_order_acquire) != nullptr) total += block_size(b);
+    }
+    return total;
+}
+
+template <typename T>
+typename concurrent_vector<T>::reference concurrent_vector<T>::operator [](size_type idx) noexcept {
+    return *slot(idx);
+}
+
+template <typename T>
+typename concurrent_vector<T>::const_reference concurrent_vector<T>::operator [](size_type idx) const noexcept {
+    return *slot(idx);
+}
+
+template <typename T>
+typename concurrent_vector<T>::reference concurrent_vector<T>::at(size_type pos) {
+    if (pos >= size()) throw std::out_of_range("index out of range");
+    if (!is_built(pos)) throw std::out_of_range("no element built at this index");
+    return *slot(pos);
+}
+
+template <typename T>
+typename concurrent_vector<T>::const_reference concurrent_vector<T>::at(size_type pos) const {
+    if (pos >= size()) throw std::out_of_range("index out of range");
+    if (!is_built(pos)) throw std::out_of_range("no element built at this index");
+    return *slot(pos);
+}
+
+template <typename T>
+template <class ... Args>
+typename concurrent_vector<T>::size_type concurrent_vector<T>::emplace_back(Args && ... args) {
+    // if a block or the element cannot be made the index stays a hole
+    const size_type idx = num_reserved.fetch_add(1, std::memory_order_acq_rel);
+    ensure_blocks(idx, idx + 1);
+    construct_at(idx, std::forward<Args>(args) ...);
+    return idx;
+}
+
+template <typename T>
+typename concurrent_vector<T>::size_type concurrent_vector<T>::push_back(const T &val) {
+    return emplace_back(val);
+}
+
+template <typename T>
+typename concurrent_vector<T>::size_type concurrent_vector<T>::push_back(T &&val) {
+    return emplace_back(std::move(val));
+}
+
+template <typename T>
+typename concurrent_vector<T>::size_type concurrent_vector<T>::grow_by(size_type n) {
+    // on a throw the slots from the failing one on stay holes
+    const size_type first = num_reserved.fetch_add(n, std::memory_order_acq_rel);
+    ensure_blocks(first, first + n);
+    for (size_type i = first; i < first + n; ++i) construct_at(i);
+    return first;
+}
+
+template <typename T>
+typename concurrent_vector<T>::size_type concurrent_vector<T>::grow_by(size_type n, const T &val) {
+    const size_type first = num_reserved.fetch_add(n, std::memory_order_acq_rel);
+    ensure_blocks(first, first + n);
+    for (size_type i = first; i < first + n; ++i) construct_at(i, val);
+    return first;
+}
+
+template <typename T>
+void concurrent_vector<T>::clear() noexcept {
+    const size_type n = num_reserved.load(std::memory_order_acquire);
+    for (size_type b = 0; b < max_blocks; ++b){
+        T * data = blocks[b].load(std::memory_order_acquire);
+        if (data == nullptr) continue;
+        const size_type start = block_start(b);
+        const std::atomic<bool> * built = built_flags(data, b);
+        for (size_type i = 0; i < block_size(b) && start + i < n; ++i){
+            if (built[i].load(std::memory_order_relaxed)) data[i].~T();
+        }
+        deallocate_storage(data);
+        blocks[b].store(nullptr, std::memory_order_relaxed);
+    }
+    num_reserved.store(0, std::memory_order_release);
+}
+
+template <typename T>
+inline T * concurrent_vector<T>::slot(size_type idx) const noexcept {
+    const location_type loc = locate(idx);
+    return blocks[loc.block].load(std::memory_order_acquire) + loc.offset;
+}
+
+// raw storage, elements are constructed one by one as their index is handed out
+template <typename T>
+T * concurrent_vector<T>::install_block(size_type block) {
+    T * current = blocks[block].load(std::memory_order_acquire);
+    if (current != nullptr) return current;
+
+    T * fresh = allocate_storage(block_size(block));
+    if (blocks[block].compare_exchange_strong(current, fresh, std::memory_order_acq_rel, std::memory_order_acquire)){
+        return fresh;
+    }
+    // another thread installed it first
+    deallocate_storage(fresh);
+    return current;
+}
+
+// aligned for T, plain operator new only guarantees the default new
+// alignment. The built flags of the slots follow the elements, all clear
+template <typename T>
+inline T * concurrent_vector<T>::allocate_storage(size_type sz) {
+    void * raw = ::operator new(sz * (sizeof(T) + sizeof(std::atomic<bool>)), std::align_val_t(alignof(T)));
+    std::atomic<bool> * built = reinterpret_cast<std::atomic<bool> *>(static_cast<unsigned char *>(raw) + sz * sizeof(T));
+    for (size_type i = 0; i < sz; ++i) ::new (static_cast<void *>(built + i)) std::atomic<bool>(false);
+    return static_cast<T *>(raw);
+}
+
+template <typename T>
+inline void concurrent_vector<T>::deallocate_storage(T * data) noexcept {
+    ::operator delete(static_cast<void *>(data), std::align_val_t(alignof(T)));
+}
+
+template <typename T>
+inline std::atomic<bool> * concurrent_vector<T>::built_flags(T * data, size_type block) noexcept {
+    return reinterpret_cast<std::atomic<bool> *>(reinterpret_cast<unsigned char *>(data) + block_size(block) * sizeof(T));
+}
+
+template <typename T>
+inline bool concurrent_vector<T>::is_built(size_type idx) const noexcept {
+    const location_type loc = locate(idx);
+    T * data = blocks[loc.block].load(std::memory_order_acquire);
+    return data != nullptr && built_flags(data, loc.block)[loc.offset].load(std::memory_order_acquire);
+}
+
+template <typename T>
+void concurrent_vector<T>::ensure_blocks(size_type first, size_type last) {
+    if (first == last) return;
+    const size_type end_block = locate(last - 1).block;
+    for (size_type b = locate(first).block; b <= end_block; ++b){
+        install_block(b);
+    }
+}
+
+/*
+ * the slot is already counted in size() and cannot be given back, so a
+ * throwing constructor leaves its flag clear and the slot stays a hole
+ */
+template <typename T>
+template <class ... Args>
+void concurrent_vector<T>::construct_at(size_type idx, Args && ... args) {
+    const location_type loc = locate(idx);
+    T * data = blocks[loc.block].load(std::memory_order_acquire);
+    ::new (static_cast<void *>(data + loc.offset)) T(std::forward<Args>(args) ...);
+    built_flags(data, loc.block)[loc.offset].store(true, std::memory_order_release);
+}
+
+} // namespace jrd
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef _JRD_GROWTH_POLICY_H
+#define _JRD_GROWTH_POLICY_H
+
+#include <cstddef>
+#include <limits>
+
+
+/*
+ *
+ * Growth policies for jrd::vector
+ *
+ * A policy fixes the size of every block at compile time and supplies the
+ * index arithmetic for that layout, so jrd::vector<T, Alloc, Policy> pays
+ * nothing at run time for the choice.
+ *
+ * doubling_growth<InitialSize, StepsPerDoubling>
+ *      blocks double in size every StepsPerDoubling blocks. With one step
+ *      it is the original layout, 16, 16, 32, 64, ... Splitting each
+ *      doubling into more blocks grows the vector by about
+ *      2^(1 / StepsPerDoubling) per block, 1.41 with 2 steps and 1.19 with
+ *      4, which wastes less memory at the end of the chain. Both values
+ *      must be powers of two so the index math stays a clz plus shifts.
+ *
+ * fixed_growth<BlockSize>
+ *      every block holds BlockSize elements like a std::deque, an index is
+ *      split with a shift and a mask. There is no bound on the number of
+ *      blocks so the vector keeps its directory on the heap.
+ *
+ * inline_first_block<Policy>
+ *      same layout as Policy, but block 0 lives inside the vector object,
+ *      so a vector that never outgrows it never touches the heap.
+ *
+ * single_writer<Policy>
+ *      same layout as Policy, the element count is published with release
+ *      semantics once an element is built, so one thread can append while
+ *      others call size(), empty(), operator[] and at() through a const
+ *      reference without locks. Policy must be bounded, readers cannot
+ *      follow a heap directory that is reallocated under them. grow_by()
+ *      value initializes what it appends, readers may see it at once.
+ *
+ * with_memory_stats<Policy>
+ *      same layout as Policy, the vector also counts its block allocations
+ *      and frees and its peak footprint, and memory() reports them with
+ *      the live bytes and the slack. Without it none of that is compiled
+ *      in.
+ *
+ */
+
+
+namespace jrd{
+
+struct block_location {
+    size_t block;
+    size_t offset;
+};
+
+namespace detail{
+
+constexpr size_t floor_log2(size_t n) noexcept {
+    return n <= 1 ? 0 : 1 + floor_log2(n / 2);
+}
+
+constexpr bool is_pow2(size_t n) noexcept {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+inline size_t msb(size_t n) noexcept {
+    constexpr size_t top_bit = static_cast<size_t>(std::numeric_limits<unsigned long long>::digits - 1);
+    return top_bit - static_cast<size_t>(__builtin_clzll(n));
+}
+
+} // namespace detail
+
+
+template <size_t InitialSize = 16, size_t StepsPerDoubling = 1>
+struct doubling_growth {
+    static_assert(InitialSize >= 2 && detail::is_pow2(InitialSize), "initial block size must be a power of two");
+    static_assert(detail::is_pow2(StepsPerDoubling) && StepsPerDoubling <= InitialSize, "steps per doubling must be a power of two no larger than the initial size");
+
+    static constexpr size_t initial_size = InitialSize;
+    static constexpr size_t steps = StepsPerDoubling;
+    static constexpr size_t log_initial = detail::floor_log2(InitialSize);
+    static constexpr size_t log_steps = detail::floor_log2(StepsPerDoubling);
+
+    // one group of steps blocks per bit of the index above log_initial,
+    // plus the group below it, is every block a size_t index can reach
+    static constexpr size_t max_blocks = steps * (std::numeric_limits<size_t>::digits - log_initial + 1);
+    static constexpr bool bounded = true;
+    static constexpr bool inline_first = false;
+    static constexpr bool concurrent_reads = false;
+    static constexpr bool track_memory = false;
+
+    /*
+     * group 0 covers [0, initial_size), group g > 0 covers
+     * [initial_size << (g - 1), initial_size << g) and each group is cut
+     * into steps equal blocks. Or-ing in initial_size - 1 folds group 0
+     * onto the same msb as the first index of group 1 which removes the
+     * branch on idx < initial_size, and masking the low bits off the
+     * group start sends group 0 back to offset 0.
+     */
+    static inline block_location locate(size_t idx) noexcept {
+        const size_t msb = detail::msb(idx | (initial_size - 1));
+        const size_t start = (size_t(1) << msb) & ~(initial_size - 1);
+        const size_t group = msb - (log_initial - 1);
+        if constexpr (steps == 1){
+            return block_location{group, idx - start};
+        } else {
+            const size_t shift = (msb < log_initial ? log_initial : msb) - log_steps;
+            const size_t rel = idx - start;
+            return block_location{group * steps + (rel >> shift), rel & ((size_t(1) << shift) - 1)};
+        }
+    }
+
+    static constexpr size_t group_start(size_t group) noexcept {
+        // initial_size << (group - 1) for group > 0, the mask zeroes group 0
+        return ((initial_size << group) >> 1) & ~(initial_size - 1);
+    }
+
+    static constexpr size_t block_size(size_t block) noexcept {
+        const size_t group = block >> log_steps;
+        return (group < 2 ? initial_size : initial_size << (group - 1)) >> log_steps;
+    }
+
+    static constexpr size_t block_start(size_t block) noexcept {
+        return group_start(block >> log_steps) + (block & (steps - 1)) * block_size(block);
+    }
+};
+
+
+template <size_t BlockSize = 4096>
+struct fixed_growth {
+    static_assert(detail::is_pow2(BlockSize), "block size must be a power of two");
+
+    static constexpr size_t initial_size = BlockSize;
+    static constexpr size_t log_block = detail::floor_log2(BlockSize);
+    static constexpr bool bounded = false;
+    static constexpr bool inline_first = false;
+    static constexpr bool concurrent_reads = false;
+    static constexpr bool track_memory = false;
+
+    static inline block_location locate(size_t idx) noexcept {
+        return block_location{idx >> log_block, idx & (BlockSize - 1)};
+    }
+
+    static constexpr size_t block_size(size_t) noexcept {
+        return BlockSize;
+    }
+
+    static constexpr size_t block_start(size_t block) noexcept {
+        return block << log_block;
+    }
+};
+
+
+template <class Policy = doubling_growth<>>
+struct inline_first_block : Policy {
+    static constexpr bool inline_first = true;
+};
+
+
+template <class Policy = doubling_growth<>>
+struct single_writer : Policy {
+    static_assert(Policy::bounded, "single_writer needs a policy with a bounded block directory");
+    static constexpr bool concurrent_reads = true;
+};
+
+
+template <class Policy = doubling_growth<>>
+struct with_memory_stats : Policy {
+    static constexpr bool track_memory = true;
+};
+
+} // namespace jrd
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef _JRD_MAPPED_VECTOR_H
+#define _JRD_MAPPED_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "vector.h"
+
+
+/*
+ *
+ * Append only vector whose blocks live in a file
+ *
+ * Same block chain as jrd::vector, but block b is a MAP_SHARED mapping of
+ * its own range of the file. Appending past the last block grows the file
+ * with ftruncate and maps the next block; nothing already mapped moves.
+ * The element count lives in a header page at the front of the file and
+ * is bumped after each element is written.
+ *
+ * Opening an existing file maps the header and the blocks and is done,
+ * the pages are read in by the kernel on first touch, so reopen time does
+ * not depend on the size of the file. The file only holds raw T, so T
+ * must be trivially copyable and the file is tied to the machine that
+ * wrote it (endianness, sizeof(T)), which the header checks. The header
+ * also holds a hash of every block size of the policy, two policies with
+ * the same first block can still cut the rest of the chain differently.
+ *
+ * The default policy starts at 4096 element blocks so every block begins
+ * on a page boundary of the file whatever sizeof(T) is.
+ *
+ * Written data reaches the file when the kernel writes the pages back,
+ * in no particular order, call sync() to force it. Until sync() returns
+ * a crash can leave the count in the header ahead of the elements.
+ *
+ */
+
+
+namespace jrd{
+
+template <typename T, typename Policy = doubling_growth<4096>>
+class mapped_vector {
+    static_assert(std::is_trivially_copyable<T>::value, "jrd::mapped_vector stores raw bytes, T must be trivially copyable");
+    static_assert(Policy::bounded && !Policy::inline_first, "jrd::mapped_vector needs a bounded policy without an inline block");
+
+    public:
+        typedef T                                     value_type;
+        typedef T &                                   reference;
+        typedef const T &                             const_reference;
+        typedef ptrdiff_t                             difference_type;
+        typedef size_t                                size_type;
+        typedef typename vector<T, std::allocator<T>, Policy>::segment       segment;
+        typedef typename vector<T, std::allocator<T>, Policy>::const_segment const_segment;
+
+        // opens path, creating an empty vector there if it does not exist
+        explicit mapped_vector(const std::string &path);
+        mapped_vector(const mapped_vector &) = delete;
+        mapped_vector & operator = (const mapped_vector &) = delete;
+        ~mapped_vector();
+
+
+        bool empty() const noexcept;
+        size_type size() const noexcept;
+        size_type capacity() const noexcept;
+
+
+        reference operator [](size_type) noexcept;
+        const_reference operator [](size_type) const noexcept;
+        reference at(size_type);
+        const_reference at(size_type) const;
+
+
+        void push_back(const T &);
+        void append(const T * data, size_type n);
+
+
+        template <class Function>
+        void for_each_segment(Function f);
+        template <class Function>
+        void for_each_segment(Function f) const;
+
+
+        // drops every element and truncates the file back to the header
+        void clear();
+        // flushes the header and every block to the file
+        void sync();
+
+    private:
+        struct file_header {
+            char magic[8];
+            std::uint64_t version;
+            std::uint64_t element_size;
+            std::uint64_t initial_size;
+            std::uint64_t layout;
+            std::uint64_t header_bytes;
+            std::uint64_t count;
+        };
+
+        static constexpr char file_magic[8] = {'J', 'R', 'D', 'M', 'A', 'P', 'V', '1'};
+        static constexpr std::uint64_t file_version = 2;
+
+        int fd;
+        size_type header_bytes;
+        file_header * header;
+
+        size_type num_elements = 0;
+        size_type next_free_index = 0;
+        size_type num_blocks = 0;
+        size_type num_mapped = 0;
+        size_type tail_size = 0;
+
+        T * blocks[Policy::max_blocks];
+
+        void map_header(bool fresh);
+        void map_block(size_type b);
+        void next_block();
+        void unmap_all() noexcept;
+        size_type file_offset(size_type b) const noexcept;
+        static constexpr std::uint64_t layout_hash() noexcept;
+        // err defaults to errno at the call, pass it when a cleanup call comes in between
+        [[noreturn]] static void fail(const char * what, int err = errno);
+};
+
+
+template <typename T, typename Policy>
+constexpr char mapped_vector<T, Policy>::file_magic[8];
+
+template <typename T, typename Policy>
+mapped_vector<T, Policy>::mapped_vector(const std::string &path) : fd(-1), header_bytes(0), header(nullptr), blocks() {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) fail("jrd::mapped_vector open");
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0){
+        const int err = errno;
+        ::close(fd);
+        fail("jrd::mapped_vector fstat", err);
+    }
+    try {
+        map_header(st.st_size == 0);
+
+        // map every block the file already holds, this touches no data pages
+        const size_type file_size = static_cast<size_type>(st.st_size);
+        while (file_offset(num_mapped + 1) <= file_size) map_block(num_mapped);
+
+        num_elements = static_cast<size_type>(header->count);
+        if (num_elements > capacity()) throw std::runtime_error("jrd::mapped_vector file is shorter than its element count");
+        if (num_elements > 0){
+            const block_location loc = Policy::locate(num_elements - 1);
+            num_blocks = loc.block + 1;
+            next_free_index = loc.offset + 1;
+            tail_size = Policy::block_size(loc.block);
+        }
+    } catch (...) {
+        unmap_all();
+        ::close(fd);
+        throw;
+    }
+}
+
+template <typename T, typename Policy>
+mapped_vector<T, Policy>::~mapped_vector() {
+    unmap_all();
+    ::close(fd);
+}
+
+template <typename T, typename Policy>
+bool mapped_vector<T, Policy>::empty() const noexcept {
+    return num_elements == 0;
+}
+
+template <typename T, typename Policy>
+typename mapped_vector<T, Policy>::size_type mapped_vector<T, Policy>::size() const noexcept {
+    return num_elements;
+}
+
+template <typename T, typename Policy>
+typename mapped_vector<T, Policy>::size_type mapped_vector<T, Policy>::capacity() const noexcept {
+    return Policy::block_start(num_mapped);
+}
+
+template <typename T, typename Policy>
+typename mapped_vector<T, Policy>::reference mapped_vector<T, Policy>::operator [](size_type idx) noexcept {
+    const block_location loc = Policy::locate(idx);
+    return blocks[loc.block][loc.offset];
+}
+
+template <typename T, typename Policy>
+typename mapped_vector<T, Policy>::const_reference mapped_vector<T, Policy>::operator [](size_type idx) const noexcept {
+    const block_location loc = Policy::locate(idx);
+    return blocks[loc.block][loc.offset];
+}
+
+template <typename T, typename Policy>
+typename mapped_vector<T, Policy>::reference mapped_vector<T, Policy>::at(size_type pos) {
+    if (pos >= num_elements) throw std::out_of_range("index out of range");
+    return (*this)[pos];
+}
+
+template <typename T, typename Policy>
+typename mapped_vector<T, Policy>::const_reference mapped_vector<T, Policy>::at(size_type pos) const {
+    if (pos >= num_elements) throw std::out_of_range("index out of range");
+    return (*this)[pos];
+}
+
+// the element is written before the count so a reader of the mapping in
+// this process never sees a slot counted before it is filled. That is all
+// it promises: the kernel writes dirty pages back in any order, after a
+// crash the file can count a slot that never reached it. sync() makes
+// the data durable but does not order these two writes either
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::push_back(const T &val) {
+    if (next_free_index == tail_size) next_block();
+    blocks[num_blocks - 1][next_free_index++] = val;
+    header->count = ++num_elements;
+}
+
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::append(const T * data, size_type n) {
+    while (n > 0){
+        if (next_free_index == tail_size) next_block();
+        const size_type room = tail_size - next_free_index;
+        const size_type k = n < room ? n : room;
+        std::memcpy(blocks[num_blocks - 1] + next_free_index, data, k * sizeof(T));
+        next_free_index += k;
+        num_elements += k;
+        data += k;
+        n -= k;
+    }
+    header->count = num_elements;
+}
+
+template <typename T, typename Policy>
+template <class Function>
+void mapped_vector<T, Policy>::for_each_segment(Function f) {
+    for (size_type b = 0; b < num_blocks; ++b){
+        const size_type n = b + 1 == num_blocks ? next_free_index : Policy::block_size(b);
+        f(segment{blocks[b], blocks[b] + n});
+    }
+}
+
+template <typename T, typename Policy>
+template <class Function>
+void mapped_vector<T, Policy>::for_each_segment(Function f) const {
+    for (size_type b = 0; b < num_blocks; ++b){
+        const size_type n = b + 1 == num_blocks ? next_free_index : Policy::block_size(b);
+        f(const_segment{blocks[b], blocks[b] + n});
+    }
+}
+
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::clear() {
+    for (size_type b = 0; b < num_mapped; ++b){
+        ::munmap(blocks[b], Policy::block_size(b) * sizeof(T));
+        blocks[b] = nullptr;
+    }
+    header->count = 0;
+    num_elements = 0;
+    next_free_index = 0;
+    num_blocks = 0;
+    num_mapped = 0;
+    tail_size = 0;
+    if (::ftruncate(fd, static_cast<off_t>(header_bytes)) != 0) fail("jrd::mapped_vector ftruncate");
+}
+
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::sync() {
+    for (size_type b = 0; b < num_blocks; ++b){
+        if (::msync(blocks[b], Policy::block_size(b) * sizeof(T), MS_SYNC) != 0) fail("jrd::mapped_vector msync");
+    }
+    if (::msync(header, header_bytes, MS_SYNC) != 0) fail("jrd::mapped_vector msync");
+}
+
+/*
+ *
+ * file layout
+ *
+ * [header, one page][block 0][block 1]... with block b at
+ * header_bytes + block_start(b) * sizeof(T)
+ *
+ */
+
+// FNV-1a over the size of every block the policy can have
+template <typename T, typename Policy>
+constexpr std::uint64_t mapped_vector<T, Policy>::layout_hash() noexcept {
+    std::uint64_t h = 14695981039346656037ull;
+    for (size_type b = 0; b < Policy::max_blocks; ++b){
+        std::uint64_t sz = Policy::block_size(b);
+        for (int i = 0; i < 8; ++i){
+            h = (h ^ (sz & 0xff)) * 1099511628211ull;
+            sz >>= 8;
+        }
+    }
+    return h;
+}
+
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::map_header(bool fresh) {
+    const size_type page_size = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+    if ((Policy::block_size(0) * sizeof(T)) % page_size != 0){
+        throw std::invalid_argument("jrd::mapped_vector blocks must be a multiple of the page size");
+    }
+
+    if (fresh){
+        header_bytes = page_size;
+        if (::ftruncate(fd, static_cast<off_t>(header_bytes)) != 0) fail("jrd::mapped_vector ftruncate");
+    } else {
+        file_header on_disk;
+        if (::pread(fd, &on_disk, sizeof(on_disk), 0) != static_cast<ssize_t>(sizeof(on_disk))){
+            throw std::runtime_error("jrd::mapped_vector file is too short for a header");
+        }
+        if (std::memcmp(on_disk.magic, file_magic, sizeof(file_magic)) != 0 || on_disk.version != file_version){
+            throw std::runtime_error("jrd::mapped_vector file has no jrd::mapped_vector header");
+        }
+        if (on_disk.element_size != sizeof(T) || on_disk.initial_size != Policy::block_size(0) || on_disk.layout != layout_hash()){
+            throw std::runtime_error("jrd::mapped_vector file was written with a different element type or policy");
+        }
+        if (on_disk.header_bytes == 0 || on_disk.header_bytes % page_size != 0){
+            throw std::runtime_error("jrd::mapped_vector header size does not fit this page size");
+        }
+        header_bytes = static_cast<size_type>(on_disk.header_bytes);
+    }
+
+    void * p = ::mmap(nullptr, header_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) fail("jrd::mapped_vector mmap");
+    header = static_cast<file_header *>(p);
+
+    if (fresh){
+        std::memcpy(header->magic, file_magic, sizeof(file_magic));
+        header->version = file_version;
+        header->element_size = sizeof(T);
+        header->initial_size = Policy::block_size(0);
+        header->layout = layout_hash();
+        header->header_bytes = header_bytes;
+        header->count = 0;
+    }
+}
+
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::map_block(size_type b) {
+    const size_type bytes = Policy::block_size(b) * sizeof(T);
+    void * p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(file_offset(b)));
+    if (p == MAP_FAILED) fail("jrd::mapped_vector mmap");
+    blocks[b] = static_cast<T *>(p);
+    ++num_mapped;
+}
+
+// grows the file to cover the next block and maps it, or steps into a
+// block that was already in the file
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::next_block() {
+    if (num_blocks == num_mapped){
+        if (::ftruncate(fd, static_cast<off_t>(file_offset(num_blocks + 1))) != 0) fail("jrd::mapped_vector ftruncate");
+        map_block(num_blocks);
+    }
+    tail_size = Policy::block_size(num_blocks);
+    next_free_index = 0;
+    ++num_blocks;
+}
+
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::unmap_all() noexcept {
+    for (size_type b = 0; b < num_mapped; ++b){
+        ::munmap(blocks[b], Policy::block_size(b) * sizeof(T));
+    }
+    num_mapped = 0;
+    if (header != nullptr) ::munmap(header, header_bytes);
+    header = nullptr;
+}
+
+template <typename T, typename Policy>
+typename mapped_vector<T, Policy>::size_type mapped_vector<T, Policy>::file_offset(size_type b) const noexcept {
+    return header_bytes + Policy::block_start(b) * sizeof(T);
+}
+
+template <typename T, typename Policy>
+void mapped_vector<T, Policy>::fail(const char * what, int err) {
+    throw std::system_error(err, std::generic_category(), what);
+}
+
+} // namespace jrd
+
+#endif
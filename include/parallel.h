@@ -0,0 +1,128 @@
+#ifndef _JRD_PARALLEL_H
+#define _JRD_PARALLEL_H
+
+#include <cstddef>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "vector.h"
+#include "thread_pool.h"
+
+
+/*
+ *
+ * Parallel for_each, transform and reduce over jrd::vector
+ *
+ * The segments are cut into chunks of at most grain elements, by default
+ * about 256KiB worth of T so a chunk sits in L2. The first blocks are
+ * smaller than that and stay whole while the large tail blocks get split,
+ * which keeps the tasks close in size even though the blocks double.
+ * The chunks are then run on a jrd::thread_pool.
+ *
+ */
+
+
+namespace jrd{
+namespace parallel{
+
+template <typename T>
+constexpr size_t default_grain() noexcept {
+    return sizeof(T) >= (size_t(256) << 10) ? 1 : (size_t(256) << 10) / sizeof(T);
+}
+
+namespace detail{
+
+template <typename U>
+struct chunk {
+    U * data;
+    size_t size;
+    size_t base;    // index of data[0] in the vector
+};
+
+template <typename U, class Range>
+std::vector<chunk<U>> split(const Range &segments, size_t grain) {
+    if (grain == 0) grain = 1;
+    std::vector<chunk<U>> chunks;
+    size_t base = 0;
+    for (auto seg : segments){
+        for (size_t off = 0; off < seg.size(); off += grain){
+            chunks.push_back(chunk<U>{seg.data() + off, std::min(grain, seg.size() - off), base + off});
+        }
+        base += seg.size();
+    }
+    return chunks;
+}
+
+} // namespace detail
+
+
+// f(vec[i]) for every element, in no particular order
+template <typename T, typename Allocator, typename Policy, class Function>
+void for_each(vector<T, Allocator, Policy> &vec, Function f, thread_pool &pool = thread_pool::default_pool(), size_t grain = default_grain<T>()) {
+    const auto chunks = detail::split<T>(vec.segments(), grain);
+    pool.run(chunks.size(), [&](size_t c){
+        T * p = chunks[c].data;
+        const size_t n = chunks[c].size;
+        for (size_t i = 0; i < n; ++i) f(p[i]);
+    });
+}
+
+// dst[i] = op(src[i]), both vectors must already have the same size, not the same policy
+template <typename T, typename Allocator, typename Policy, typename U, typename AllocatorU, typename PolicyU, class UnaryOp>
+void transform(const vector<T, Allocator, Policy> &src, vector<U, AllocatorU, PolicyU> &dst, UnaryOp op, thread_pool &pool = thread_pool::default_pool(), size_t grain = default_grain<T>()) {
+    if (src.size() != dst.size()) throw std::length_error("jrd::parallel::transform size mismatch");
+    const auto chunks = detail::split<const T>(src.segments(), grain);
+    // dst.segments() clones any block still shared with a copy, here on
+    // the calling thread, the tasks then only write through plain pointers.
+    // One entry per dst block, its policy may cut the blocks elsewhere
+    const auto out = detail::split<U>(dst.segments(), dst.size());
+    pool.run(chunks.size(), [&](size_t c){
+        const T * p = chunks[c].data;
+        size_t n = chunks[c].size;
+        // the dst block holding the first index of the chunk
+        size_t s = static_cast<size_t>(std::upper_bound(out.begin(), out.end(), chunks[c].base,
+            [](size_t i, const detail::chunk<U> &blk){ return i < blk.base; }) - out.begin()) - 1;
+        size_t off = chunks[c].base - out[s].base;
+        while (n > 0){
+            U * q = out[s].data + off;
+            const size_t k = n < out[s].size - off ? n : out[s].size - off;
+            for (size_t i = 0; i < k; ++i) q[i] = op(p[i]);
+            p += k;
+            n -= k;
+            ++s;
+            off = 0;
+        }
+    });
+}
+
+/*
+ * op must be associative, each chunk is folded on its own and the
+ * partial results are then combined in index order starting from init
+ */
+template <typename T, typename Allocator, typename Policy, class BinaryOp>
+T reduce(const vector<T, Allocator, Policy> &vec, T init, BinaryOp op, thread_pool &pool = thread_pool::default_pool(), size_t grain = default_grain<T>()) {
+    const auto chunks = detail::split<const T>(vec.segments(), grain);
+    // empty until the chunk is folded, T need not be default constructible
+    std::vector<std::optional<T>> partial(chunks.size());
+    pool.run(chunks.size(), [&](size_t c){
+        const T * p = chunks[c].data;
+        const size_t n = chunks[c].size;
+        T acc = p[0];
+        for (size_t i = 1; i < n; ++i) acc = op(acc, p[i]);
+        partial[c].emplace(std::move(acc));
+    });
+    for (const std::optional<T> &v : partial) init = op(init, *v);
+    return init;
+}
+
+template <typename T, typename Allocator, typename Policy>
+T reduce(const vector<T, Allocator, Policy> &vec, T init, thread_pool &pool = thread_pool::default_pool()) {
+    return reduce(vec, init, [](const T &a, const T &b){ return a + b; }, pool);
+}
+
+} // namespace parallel
+} // namespace jrd
+
+#endif
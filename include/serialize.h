@@ -0,0 +1,493 @@
+#ifndef _JRD_SERIALIZE_H
+#define _JRD_SERIALIZE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include <climits>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "vector.h"
+
+
+/*
+ *
+ * Saving and loading jrd::vector
+ *
+ * The format is a 64 byte header followed by the elements:
+ *
+ *      magic "JRDVEC01", version, flags, element count, payload bytes,
+ *      sizeof(T), first block size of the writer's policy, checksum
+ *
+ * For trivially copyable T the payload is the raw elements in index
+ * order. save(fd) hands the kernel the header plus one iovec per segment
+ * with writev and load(fd) grows the vector first and readv's straight
+ * into its blocks, so nothing goes through a staging buffer. The byte
+ * stream does not depend on the block layout, a file can be loaded into a
+ * vector with any growth policy.
+ *
+ * Other types go through jrd::serial_traits<T>, which is provided for
+ * std::basic_string and can be specialized for anything else. That path
+ * is buffered and serializes twice on save, once to size and checksum
+ * the payload and once to write it.
+ *
+ * The checksum covers the payload, load throws std::runtime_error when it
+ * or the header does not match, and clears the vector. The header is not
+ * trusted for sizes: a count too large for memory is refused, load(fd)
+ * checks the payload fits in what is left of a regular file, and
+ * elsewhere the vector, like every saved string, is grown in steps no
+ * larger than what has been read so far. load(fd) stops at the end of
+ * the record, so several can be stored one after the other in the same
+ * file.
+ *
+ */
+
+
+namespace jrd{
+
+/*
+ * specialize for element types that are not trivially copyable,
+ *      template <class Writer> static void save(Writer &out, const T &)
+ *      template <class Reader> static T load(Reader &in)
+ * with out.put(const void *, size_t) and in.get(void *, size_t)
+ */
+template <typename T, typename = void>
+struct serial_traits;
+
+namespace detail{
+
+// how many more elements to grow by when the source size is not known,
+// never more than what is already in, so a lying count costs at most
+// twice the memory of what was actually read
+inline size_t next_step(size_t have, size_t left) noexcept {
+    const size_t step = have < 4096 ? 4096 : have;
+    return left < step ? left : step;
+}
+
+} // namespace detail
+
+template <typename CharT, typename Traits, typename Alloc>
+struct serial_traits<std::basic_string<CharT, Traits, Alloc>> {
+    typedef std::basic_string<CharT, Traits, Alloc> string_type;
+
+    template <class Writer>
+    static void save(Writer &out, const string_type &s) {
+        const std::uint64_t n = s.size();
+        out.put(&n, sizeof(n));
+        out.put(s.data(), s.size() * sizeof(CharT));
+    }
+
+    template <class Reader>
+    static string_type load(Reader &in) {
+        std::uint64_t n = 0;
+        in.get(&n, sizeof(n));
+        string_type s;
+        if (n > s.max_size()) throw std::runtime_error("jrd::load string length is inconsistent");
+        // the length is not trusted either, grow with what has been read
+        for (size_t done = 0; done < n;){
+            const size_t step = detail::next_step(done, n - done);
+            s.resize(done + step);
+            in.get(&s[done], step * sizeof(CharT));
+            done += step;
+        }
+        return s;
+    }
+};
+
+namespace detail{
+
+struct serial_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint64_t count;
+    std::uint64_t payload_bytes;
+    std::uint64_t element_size;
+    std::uint64_t first_block;
+    std::uint64_t checksum;
+    std::uint64_t reserved;
+};
+
+static_assert(sizeof(serial_header) == 64, "the serial header is 64 bytes on disk");
+
+constexpr char serial_magic[8] = {'J', 'R', 'D', 'V', 'E', 'C', '0', '1'};
+constexpr std::uint32_t serial_version = 1;
+constexpr std::uint32_t serial_raw = 1;     // payload is raw T, otherwise serial_traits<T>
+
+/*
+ * 64 bit multiply rotate hash over 8 byte words, the carry makes the
+ * result independent of how the stream is cut into update() calls
+ */
+class checksum {
+    public:
+        void update(const void * data, size_t n) noexcept {
+            const unsigned char * p = static_cast<const unsigned char *>(data);
+            if (carry_len != 0){
+                const size_t take = n < sizeof(carry) - carry_len ? n : sizeof(carry) - carry_len;
+                std::memcpy(carry + carry_len, p, take);
+                carry_len += take;
+                p += take;
+                n -= take;
+                if (carry_len < sizeof(carry)) return;
+                mix_word(carry);
+                carry_len = 0;
+            }
+            for (; n >= 8; n -= 8, p += 8) mix_word(p);
+            std::memcpy(carry, p, n);
+            carry_len = n;
+        }
+
+        std::uint64_t value() const noexcept {
+            std::uint64_t h = state ^ total;
+            for (size_t i = 0; i < carry_len; ++i) h = (h ^ carry[i]) * prime;
+            h ^= h >> 32;
+            return h;
+        }
+
+    private:
+        static constexpr std::uint64_t prime = 0x9E3779B97F4A7C15ull;
+
+        std::uint64_t state = 0xCBF29CE484222325ull;
+        std::uint64_t total = 0;
+        unsigned char carry[8] = {};
+        size_t carry_len = 0;
+
+        void mix_word(const unsigned char * p) noexcept {
+            std::uint64_t w;
+            std::memcpy(&w, p, sizeof(w));
+            state = (state ^ w) * prime;
+            state = (state << 31) | (state >> 33);
+            total += 8;
+        }
+};
+
+[[noreturn]] inline void fail(const char * what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// writes every iovec, resuming after partial writes and in IOV_MAX batches
+inline void write_all(int fd, struct iovec * iov, size_t n) {
+    while (n > 0){
+        const int batch = static_cast<int>(n < IOV_MAX ? n : IOV_MAX);
+        ssize_t done = ::writev(fd, iov, batch);
+        if (done < 0){
+            if (errno == EINTR) continue;
+            fail("jrd::save writev");
+        }
+        size_t left = static_cast<size_t>(done);
+        while (n > 0 && left >= iov->iov_len){
+            left -= iov->iov_len;
+            ++iov;
+            --n;
+        }
+        if (n > 0){
+            iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+}
+
+inline void read_all(int fd, struct iovec * iov, size_t n) {
+    while (n > 0){
+        const int batch = static_cast<int>(n < IOV_MAX ? n : IOV_MAX);
+        ssize_t done = ::readv(fd, iov, batch);
+        if (done < 0){
+            if (errno == EINTR) continue;
+            fail("jrd::load readv");
+        }
+        if (done == 0) throw std::runtime_error("jrd::load unexpected end of file");
+        size_t left = static_cast<size_t>(done);
+        while (n > 0 && left >= iov->iov_len){
+            left -= iov->iov_len;
+            ++iov;
+            --n;
+        }
+        if (n > 0){
+            iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+}
+
+// serial_traits sinks and sources, all count the bytes and keep a checksum
+
+struct hash_writer {
+    checksum sum = checksum();
+    std::uint64_t bytes = 0;
+
+    void put(const void * data, size_t n) { sum.update(data, n); bytes += n; }
+};
+
+class fd_writer {
+    public:
+        explicit fd_writer(int in_fd) : fd(in_fd), buf() { buf.reserve(capacity); }
+
+        void put(const void * data, size_t n) {
+            if (buf.size() + n > capacity) flush();
+            if (n > capacity){
+                struct iovec iov{const_cast<void *>(data), n};
+                write_all(fd, &iov, 1);
+                return;
+            }
+            const char * p = static_cast<const char *>(data);
+            buf.insert(buf.end(), p, p + n);
+        }
+
+        void flush() {
+            if (buf.empty()) return;
+            struct iovec iov{buf.data(), buf.size()};
+            write_all(fd, &iov, 1);
+            buf.clear();
+        }
+
+    private:
+        static constexpr size_t capacity = size_t(64) << 10;
+        int fd;
+        std::vector<char> buf;
+};
+
+// reads no further than the payload_bytes left in the record
+class fd_reader {
+    public:
+        fd_reader(int in_fd, std::uint64_t payload_bytes) : fd(in_fd), buf(capacity), pos(0), len(0), left(payload_bytes), sum() {}
+
+        void get(void * data, size_t n) {
+            char * p = static_cast<char *>(data);
+            while (n > 0){
+                if (pos == len) refill();
+                const size_t k = n < len - pos ? n : len - pos;
+                std::memcpy(p, buf.data() + pos, k);
+                sum.update(p, k);
+                pos += k;
+                p += k;
+                n -= k;
+            }
+        }
+
+        std::uint64_t checksum_value() const noexcept { return sum.value(); }
+        bool at_end() const noexcept { return pos == len && left == 0; }
+
+    private:
+        static constexpr size_t capacity = size_t(64) << 10;
+        int fd;
+        std::vector<char> buf;
+        size_t pos;
+        size_t len;
+        std::uint64_t left;
+        checksum sum;
+
+        void refill() {
+            if (left == 0) throw std::runtime_error("jrd::load element runs past the payload");
+            const size_t want = left < buf.size() ? left : buf.size();
+            ssize_t got;
+            do {
+                got = ::read(fd, buf.data(), want);
+            } while (got < 0 && errno == EINTR);
+            if (got < 0) fail("jrd::load read");
+            if (got == 0) throw std::runtime_error("jrd::load unexpected end of file");
+            pos = 0;
+            len = static_cast<size_t>(got);
+            left -= len;
+        }
+};
+
+struct stream_writer {
+    std::ostream & out;
+
+    void put(const void * data, size_t n) {
+        out.write(static_cast<const char *>(data), static_cast<std::streamsize>(n));
+        if (!out) throw std::runtime_error("jrd::save stream write failed");
+    }
+};
+
+struct stream_reader {
+    std::istream & in;
+    checksum sum;
+
+    void get(void * data, size_t n) {
+        in.read(static_cast<char *>(data), static_cast<std::streamsize>(n));
+        if (!in) throw std::runtime_error("jrd::load unexpected end of stream");
+        sum.update(data, n);
+    }
+
+    std::uint64_t checksum_value() const noexcept { return sum.value(); }
+};
+
+template <typename T, typename Allocator, typename Policy>
+serial_header make_header(const vector<T, Allocator, Policy> &vec) {
+    serial_header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, serial_magic, sizeof(serial_magic));
+    h.version = serial_version;
+    h.count = vec.size();
+    h.element_size = sizeof(T);
+    h.first_block = Policy::block_size(0);
+
+    if constexpr (std::is_trivially_copyable<T>::value){
+        h.flags = serial_raw;
+        checksum sum;
+        vec.for_each_segment([&](typename vector<T, Allocator, Policy>::const_segment seg){
+            sum.update(seg.data(), seg.size() * sizeof(T));
+        });
+        h.payload_bytes = h.count * sizeof(T);
+        h.checksum = sum.value();
+    } else {
+        hash_writer sizer;
+        for (const T &v : vec) serial_traits<T>::save(sizer, v);
+        h.payload_bytes = sizer.bytes;
+        h.checksum = sizer.sum.value();
+    }
+    return h;
+}
+
+template <typename T>
+void check_header(const serial_header &h) {
+    if (std::memcmp(h.magic, serial_magic, sizeof(serial_magic)) != 0 || h.version != serial_version){
+        throw std::runtime_error("jrd::load not a saved jrd::vector");
+    }
+    const bool raw = std::is_trivially_copyable<T>::value;
+    if (h.element_size != sizeof(T) || ((h.flags & serial_raw) != 0) != raw){
+        throw std::runtime_error("jrd::load saved with a different element type");
+    }
+    // checked first so count * sizeof(T) below cannot wrap
+    if (h.count > SIZE_MAX / sizeof(T) || (raw && h.payload_bytes != h.count * sizeof(T))){
+        throw std::runtime_error("jrd::load header is inconsistent");
+    }
+}
+
+// a payload longer than the rest of a regular file is refused before
+// anything is allocated for it. Other kinds of fd cannot tell, false
+inline bool check_payload_fits(int fd, std::uint64_t payload_bytes) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) fail("jrd::load fstat");
+    if (!S_ISREG(st.st_mode)) return false;
+    const off_t at = ::lseek(fd, 0, SEEK_CUR);
+    if (at < 0) fail("jrd::load lseek");
+    const std::uint64_t rest = at < st.st_size ? static_cast<std::uint64_t>(st.st_size - at) : 0;
+    if (payload_bytes > rest) throw std::runtime_error("jrd::load payload runs past the end of the file");
+    return true;
+}
+
+} // namespace detail
+
+
+template <typename T, typename Allocator, typename Policy>
+void save(const vector<T, Allocator, Policy> &vec, int fd) {
+    detail::serial_header h = detail::make_header(vec);
+    if constexpr (std::is_trivially_copyable<T>::value){
+        std::vector<struct iovec> iov;
+        iov.reserve(vec.segments().size() + 1);
+        iov.push_back(iovec{&h, sizeof(h)});
+        vec.for_each_segment([&](typename vector<T, Allocator, Policy>::const_segment seg){
+            iov.push_back(iovec{const_cast<T *>(seg.data()), seg.size() * sizeof(T)});
+        });
+        detail::write_all(fd, iov.data(), iov.size());
+    } else {
+        detail::fd_writer out(fd);
+        out.put(&h, sizeof(h));
+        for (const T &v : vec) serial_traits<T>::save(out, v);
+        out.flush();
+    }
+}
+
+// replaces the contents of vec with what save() wrote at the current offset of fd
+template <typename T, typename Allocator, typename Policy>
+void load(vector<T, Allocator, Policy> &vec, int fd) {
+    detail::serial_header h;
+    struct iovec head{&h, sizeof(h)};
+    detail::read_all(fd, &head, 1);
+    detail::check_header<T>(h);
+
+    vec.clear();
+    const size_t n = h.count;
+    std::uint64_t sum = 0;
+    try {
+        // a regular file is checked up front and read in one go
+        const bool sized = detail::check_payload_fits(fd, h.payload_bytes);
+        if constexpr (std::is_trivially_copyable<T>::value){
+            if (sized) vec.reserve(n);
+            std::vector<struct iovec> iov;
+            for (size_t done = 0; done < n;){
+                const size_t step = sized ? n - done : detail::next_step(done, n - done);
+                iov.clear();
+                for (auto seg : vec.grow_by(step)){
+                    iov.push_back(iovec{seg.data(), seg.size() * sizeof(T)});
+                }
+                detail::read_all(fd, iov.data(), iov.size());
+                done += step;
+            }
+            detail::checksum c;
+            vec.for_each_segment([&](typename vector<T, Allocator, Policy>::segment seg){
+                c.update(seg.data(), seg.size() * sizeof(T));
+            });
+            sum = c.value();
+        } else {
+            detail::fd_reader in(fd, h.payload_bytes);
+            // no reserve, count says nothing about the payload size here
+            for (size_t i = 0; i < n; ++i) vec.push_back(serial_traits<T>::load(in));
+            if (!in.at_end()) throw std::runtime_error("jrd::load header is inconsistent");
+            sum = in.checksum_value();
+        }
+        if (sum != h.checksum) throw std::runtime_error("jrd::load checksum mismatch");
+    } catch (...) {
+        vec.clear();
+        throw;
+    }
+}
+
+template <typename T, typename Allocator, typename Policy>
+void save(const vector<T, Allocator, Policy> &vec, std::ostream &out) {
+    const detail::serial_header h = detail::make_header(vec);
+    detail::stream_writer w{out};
+    w.put(&h, sizeof(h));
+    if constexpr (std::is_trivially_copyable<T>::value){
+        vec.for_each_segment([&](typename vector<T, Allocator, Policy>::const_segment seg){
+            w.put(seg.data(), seg.size() * sizeof(T));
+        });
+    } else {
+        for (const T &v : vec) serial_traits<T>::save(w, v);
+    }
+}
+
+template <typename T, typename Allocator, typename Policy>
+void load(vector<T, Allocator, Policy> &vec, std::istream &in) {
+    detail::serial_header h;
+    in.read(reinterpret_cast<char *>(&h), sizeof(h));
+    if (!in) throw std::runtime_error("jrd::load unexpected end of stream");
+    detail::check_header<T>(h);
+
+    vec.clear();
+    const size_t n = h.count;
+    detail::stream_reader r{in, detail::checksum()};
+    try {
+        // the size of a stream is not known, grow as the data comes in
+        if constexpr (std::is_trivially_copyable<T>::value){
+            for (size_t done = 0; done < n;){
+                const size_t step = detail::next_step(done, n - done);
+                for (auto seg : vec.grow_by(step)){
+                    r.get(seg.data(), seg.size() * sizeof(T));
+                }
+                done += step;
+            }
+        } else {
+            for (size_t i = 0; i < n; ++i) vec.push_back(serial_traits<T>::load(r));
+        }
+        if (r.checksum_value() != h.checksum) throw std::runtime_error("jrd::load checksum mismatch");
+    } catch (...) {
+        vec.clear();
+        throw;
+    }
+}
+
+} // namespace jrd
+
+#endif
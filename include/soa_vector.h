@@ -0,0 +1,542 @@
+#ifndef _JRD_SOA_VECTOR_H
+#define _JRD_SOA_VECTOR_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "growth_policy.h"
+
+
+/*
+ *
+ * Struct of arrays vector, one array per field
+ *
+ * soa_vector<Ts...> stores row i as the i-th element of one column per
+ * type, each column on the block layout of jrd::vector, 16, 16, 32, 64,
+ * ... elements (or the layout of the Policy of basic_soa_vector). Blocks
+ * are never moved, growing allocates one new block per column.
+ *
+ * Every column has the same block sizes, so an index is decomposed once
+ * and a row of the block directory holds the pointers of all the columns
+ * for that block, operator[] costs one locate() and one directory line
+ * whatever the number of fields.
+ *
+ * operator[] returns a std::tuple of references into the columns, it
+ * reads and assigns a whole row. get<I>(i) touches field I only and
+ * column<I>() walks the blocks of one column as contiguous segments, so
+ * a scan over one field loads nothing else and vectorizes like a loop
+ * over a plain array.
+ *
+ * Only the block layout of Policy is used, the other policy flags
+ * (inline_first, concurrent_reads, track_memory) are jrd::vector's. The
+ * layout must be bounded, the directory is inline with Policy::max_blocks
+ * rows like the one of jrd::vector. Each column is allocated through
+ * Allocator rebound to its field type.
+ *
+ */
+
+
+namespace jrd{
+
+template <typename Policy, typename Allocator, typename ... Ts>
+class basic_soa_vector {
+    static_assert(sizeof ... (Ts) > 0, "soa_vector needs at least one column");
+    static_assert(Policy::bounded, "soa_vector keeps its block directory inline and needs a bounded growth policy");
+
+    public:
+        typedef std::tuple<Ts ...>                    value_type;
+        typedef std::tuple<Ts & ...>                  reference;
+        typedef std::tuple<const Ts & ...>            const_reference;
+        typedef ptrdiff_t                             difference_type;
+        typedef size_t                                size_type;
+        typedef Policy                                growth_policy;
+        typedef Allocator                             allocator_type;
+
+        static constexpr size_type num_columns = sizeof ... (Ts);
+
+        template <size_type I>
+        using column_type = typename std::tuple_element<I, value_type>::type;
+
+        // the populated prefix of one block of one column
+        template <typename U>
+        struct basic_segment {
+            U * first;
+            U * last;
+
+            U * begin() const noexcept { return first; }
+            U * end() const noexcept { return last; }
+            U * data() const noexcept { return first; }
+            size_type size() const noexcept { return static_cast<size_type>(last - first); }
+            bool empty() const noexcept { return first == last; }
+        };
+
+        template <size_type I, bool is_const>
+        class column_range;
+
+        basic_soa_vector() noexcept;
+        explicit basic_soa_vector(const Allocator &) noexcept;
+        basic_soa_vector(const basic_soa_vector &);
+        basic_soa_vector(basic_soa_vector &&) noexcept;
+        ~basic_soa_vector();
+        basic_soa_vector & operator = (const basic_soa_vector &);
+        basic_soa_vector & operator = (basic_soa_vector &&) noexcept(std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value ||
+                                                                     std::allocator_traits<Allocator>::is_always_equal::value);
+
+
+        bool empty() const noexcept;
+        size_type size() const noexcept;
+        size_type capacity() const noexcept;
+        void reserve(size_type);
+
+
+        reference operator [](size_type) noexcept;
+        const_reference operator [](size_type) const noexcept;
+        reference at(size_type);
+        const_reference at(size_type) const;
+
+        template <size_type I>
+        column_type<I> & get(size_type) noexcept;
+        template <size_type I>
+        const column_type<I> & get(size_type) const noexcept;
+
+        template <size_type I>
+        column_range<I, false> column() noexcept;
+        template <size_type I>
+        column_range<I, true> column() const noexcept;
+
+
+        // one argument per column
+        template <class ... Args>
+        void emplace_back(Args && ... args);
+        void push_back(const value_type &);
+        void push_back(value_type &&);
+        void pop_back();
+
+
+        // the allocators must compare equal unless they propagate on swap
+        void swap(basic_soa_vector &) noexcept;
+        void clear() noexcept;
+        allocator_type get_allocator() const noexcept;
+
+    private:
+        typedef block_location location_type;
+        typedef std::tuple<Ts * ...> block_type;
+        typedef std::index_sequence_for<Ts ...> columns;
+
+        typedef std::allocator_traits<Allocator> alloc_traits;
+        template <typename U>
+        using column_allocator = typename alloc_traits::template rebind_alloc<U>;
+        template <typename U>
+        using column_traits = std::allocator_traits<column_allocator<U>>;
+
+        /*
+         * one row per block a size_type index can reach, inline like the
+         * directory of a bounded jrd::vector so it never reallocates. A
+         * std::tuple value-initializes, so the rows are raw storage and a
+         * row only comes to life in emplace() when its block is allocated.
+         */
+        struct directory_type {
+            directory_type() noexcept {}
+            directory_type(const directory_type &) = delete;
+            directory_type & operator = (const directory_type &) = delete;
+
+            alignas(block_type) unsigned char slots[sizeof(block_type) * Policy::max_blocks];
+
+            block_type & operator [](size_type b) noexcept {
+                return *std::launder(reinterpret_cast<block_type *>(slots + b * sizeof(block_type)));
+            }
+            const block_type & operator [](size_type b) const noexcept {
+                return *std::launder(reinterpret_cast<const block_type *>(slots + b * sizeof(block_type)));
+            }
+            // starts row b with every column null
+            block_type & emplace(size_type b) noexcept {
+                return *::new (static_cast<void *>(slots + b * sizeof(block_type))) block_type();
+            }
+        };
+
+        size_type num_elements;
+        size_type num_allocated;
+        Allocator alloc;
+        directory_type blocks;
+
+        static inline location_type locate(size_type idx) noexcept { return Policy::locate(idx); }
+        static constexpr size_type block_start(size_type block) noexcept { return Policy::block_start(block); }
+        static constexpr size_type block_size(size_type block) noexcept { return Policy::block_size(block); }
+        inline size_type segment_length(size_type block) const noexcept;
+
+        void allocate_block();
+        void swap_rows(basic_soa_vector &other) noexcept;
+        template <size_type ... Is>
+        void move_rows_from(basic_soa_vector &other, std::index_sequence<Is ...>);
+        template <typename U>
+        U * allocate_column(size_type sz);
+        template <typename U>
+        void deallocate_column(U * data, size_type sz) noexcept;
+        template <typename U>
+        void destroy_field(U * p) noexcept;
+        template <size_type ... Is>
+        void destroy_rows(const block_type &blk, size_type first, size_type last, std::index_sequence<Is ...>) noexcept;
+        template <size_type ... Is>
+        void deallocate_block(const block_type &blk, size_type sz, std::index_sequence<Is ...>) noexcept;
+        template <size_type I, class Refs>
+        void construct_columns(const block_type &blk, size_type offset, Refs &&refs);
+        template <size_type ... Is>
+        static reference make_row(const block_type &blk, size_type offset, std::index_sequence<Is ...>) noexcept;
+        template <size_type ... Is>
+        static const_reference make_const_row(const block_type &blk, size_type offset, std::index_sequence<Is ...>) noexcept;
+
+    public:
+        /*
+         * forward range over the segments of column I, one per block that
+         * holds rows, the last one cut at size()
+         */
+        template <size_type I, bool is_const>
+        class column_range {
+            public:
+                typedef typename std::conditional<is_const, const column_type<I>, column_type<I>>::type element_type;
+                typedef basic_segment<element_type> value_type;
+
+                class iterator {
+                    public:
+                        typedef std::forward_iterator_tag iterator_category;
+                        typedef typename column_range::value_type value_type;
+                        typedef ptrdiff_t difference_type;
+                        typedef const value_type * pointer;
+                        typedef value_type reference;
+
+                        iterator(const basic_soa_vector * in_owner, size_type in_block) noexcept
+                            : owner(in_owner), block(in_block) {}
+
+                        value_type operator * () const noexcept {
+                            element_type * first = std::get<I>(owner->blocks[block]);
+                            return value_type{first, first + owner->segment_length(block)};
+                        }
+
+                        iterator & operator ++ () noexcept { ++block; return *this; }
+                        iterator operator ++ (int) noexcept { iterator tmp(*this); ++block; return tmp; }
+                        bool operator == (const iterator & rhs) const noexcept { return block == rhs.block; }
+                        bool operator != (const iterator & rhs) const noexcept { return block != rhs.block; }
+
+                    private:
+                        const basic_soa_vector * owner;
+                        size_type block;
+                };
+
+                explicit column_range(const basic_soa_vector * in_owner) noexcept
+                    : owner(in_owner), num_segments(in_owner->num_elements == 0 ? 0 : locate(in_owner->num_elements - 1).block + 1) {}
+
+                iterator begin() const noexcept { return iterator(owner, 0); }
+                iterator end() const noexcept { return iterator(owner, num_segments); }
+                size_type size() const noexcept { return num_segments; }
+                value_type operator [](size_type n) const noexcept { return *iterator(owner, n); }
+
+            private:
+                const basic_soa_vector * owner;
+                size_type num_segments;
+        };
+};
+
+template <typename ... Ts>
+using soa_vector = basic_soa_vector<doubling_growth<>, std::allocator<std::tuple<Ts ...>>, Ts ...>;
+
+
+template <typename Policy, typename Allocator, typename ... Ts>
+basic_soa_vector<Policy, Allocator, Ts ...>::basic_soa_vector() noexcept : basic_soa_vector(allocator_type()) {}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+basic_soa_vector<Policy, Allocator, Ts ...>::basic_soa_vector(const Allocator &in_alloc) noexcept
+    : num_elements(0), num_allocated(0), alloc(in_alloc), blocks() {}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+basic_soa_vector<Policy, Allocator, Ts ...>::basic_soa_vector(const basic_soa_vector &other)
+    : basic_soa_vector(alloc_traits::select_on_container_copy_construction(other.alloc)) {
+    reserve(other.num_elements);
+    for (size_type i = 0; i < other.num_elements; ++i) push_back(value_type(other[i]));
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+basic_soa_vector<Policy, Allocator, Ts ...>::basic_soa_vector(basic_soa_vector &&other) noexcept
+    : num_elements(0), num_allocated(0), alloc(other.alloc), blocks() {
+    swap_rows(other);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+basic_soa_vector<Policy, Allocator, Ts ...>::~basic_soa_vector() {
+    clear();
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+basic_soa_vector<Policy, Allocator, Ts ...> & basic_soa_vector<Policy, Allocator, Ts ...>::operator = (const basic_soa_vector &other) {
+    if (this == &other) return *this;
+    clear();
+    if constexpr (alloc_traits::propagate_on_container_copy_assignment::value) alloc = other.alloc;
+    try {
+        reserve(other.num_elements);
+        for (size_type i = 0; i < other.num_elements; ++i) push_back(value_type(other[i]));
+    } catch (...) {
+        clear();
+        throw;
+    }
+    return *this;
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+basic_soa_vector<Policy, Allocator, Ts ...> & basic_soa_vector<Policy, Allocator, Ts ...>::operator = (basic_soa_vector &&other)
+    noexcept(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value) {
+    if (this == &other) return *this;
+    clear();
+    if (alloc_traits::propagate_on_container_move_assignment::value || alloc == other.alloc){
+        if constexpr (alloc_traits::propagate_on_container_move_assignment::value) alloc = other.alloc;
+        swap_rows(other);
+    } else {
+        // the columns cannot change hands, move the rows across
+        move_rows_from(other, columns());
+        other.clear();
+    }
+    return *this;
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+bool basic_soa_vector<Policy, Allocator, Ts ...>::empty() const noexcept {
+    return num_elements == 0;
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type basic_soa_vector<Policy, Allocator, Ts ...>::size() const noexcept {
+    return num_elements;
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type basic_soa_vector<Policy, Allocator, Ts ...>::capacity() const noexcept {
+    return block_start(num_allocated);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+void basic_soa_vector<Policy, Allocator, Ts ...>::reserve(size_type n) {
+    while (capacity() < n) allocate_block();
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::reference basic_soa_vector<Policy, Allocator, Ts ...>::operator [](size_type idx) noexcept {
+    const location_type loc = locate(idx);
+    return make_row(blocks[loc.block], loc.offset, columns());
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::const_reference basic_soa_vector<Policy, Allocator, Ts ...>::operator [](size_type idx) const noexcept {
+    const location_type loc = locate(idx);
+    return make_const_row(blocks[loc.block], loc.offset, columns());
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::reference basic_soa_vector<Policy, Allocator, Ts ...>::at(size_type pos) {
+    if (pos >= size()) throw std::out_of_range("index out of range");
+    return (*this)[pos];
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::const_reference basic_soa_vector<Policy, Allocator, Ts ...>::at(size_type pos) const {
+    if (pos >= size()) throw std::out_of_range("index out of range");
+    return (*this)[pos];
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type I>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::template column_type<I> & basic_soa_vector<Policy, Allocator, Ts ...>::get(size_type idx) noexcept {
+    const location_type loc = locate(idx);
+    return std::get<I>(blocks[loc.block])[loc.offset];
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type I>
+const typename basic_soa_vector<Policy, Allocator, Ts ...>::template column_type<I> & basic_soa_vector<Policy, Allocator, Ts ...>::get(size_type idx) const noexcept {
+    const location_type loc = locate(idx);
+    return std::get<I>(blocks[loc.block])[loc.offset];
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type I>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::template column_range<I, false> basic_soa_vector<Policy, Allocator, Ts ...>::column() noexcept {
+    return column_range<I, false>(this);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type I>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::template column_range<I, true> basic_soa_vector<Policy, Allocator, Ts ...>::column() const noexcept {
+    return column_range<I, true>(this);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <class ... Args>
+void basic_soa_vector<Policy, Allocator, Ts ...>::emplace_back(Args && ... args) {
+    static_assert(sizeof ... (Args) == num_columns, "emplace_back takes one argument per column");
+    if (num_elements == capacity()) allocate_block();
+    const location_type loc = locate(num_elements);
+    construct_columns<0>(blocks[loc.block], loc.offset, std::forward_as_tuple(std::forward<Args>(args) ...));
+    ++num_elements;
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+void basic_soa_vector<Policy, Allocator, Ts ...>::push_back(const value_type &row) {
+    std::apply([this](const Ts & ... fields){ emplace_back(fields ...); }, row);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+void basic_soa_vector<Policy, Allocator, Ts ...>::push_back(value_type &&row) {
+    std::apply([this](Ts & ... fields){ emplace_back(std::move(fields) ...); }, row);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+void basic_soa_vector<Policy, Allocator, Ts ...>::pop_back() {
+    if (num_elements == 0) throw std::out_of_range("pop_back on empty soa_vector");
+    const location_type loc = locate(num_elements - 1);
+    destroy_rows(blocks[loc.block], loc.offset, loc.offset + 1, columns());
+    --num_elements;
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+void basic_soa_vector<Policy, Allocator, Ts ...>::swap(basic_soa_vector &other) noexcept {
+    swap_rows(other);
+    if constexpr (alloc_traits::propagate_on_container_swap::value) std::swap(alloc, other.alloc);
+}
+
+// the blocks change hands, the allocators stay where they are
+template <typename Policy, typename Allocator, typename ... Ts>
+void basic_soa_vector<Policy, Allocator, Ts ...>::swap_rows(basic_soa_vector &other) noexcept {
+    // the directories are inline, only the rows in use on either side move
+    const size_type n = num_allocated > other.num_allocated ? num_allocated : other.num_allocated;
+    for (size_type b = 0; b < n; ++b){
+        if (b >= num_allocated) blocks.emplace(b);
+        if (b >= other.num_allocated) other.blocks.emplace(b);
+        std::swap(blocks[b], other.blocks[b]);
+    }
+    std::swap(num_elements, other.num_elements);
+    std::swap(num_allocated, other.num_allocated);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type ... Is>
+void basic_soa_vector<Policy, Allocator, Ts ...>::move_rows_from(basic_soa_vector &other, std::index_sequence<Is ...>) {
+    reserve(other.num_elements);
+    for (size_type i = 0; i < other.num_elements; ++i) emplace_back(std::move(other.template get<Is>(i)) ...);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+void basic_soa_vector<Policy, Allocator, Ts ...>::clear() noexcept {
+    for (size_type b = 0; b < num_allocated; ++b){
+        destroy_rows(blocks[b], 0, segment_length(b), columns());
+        deallocate_block(blocks[b], block_size(b), columns());
+    }
+    num_allocated = 0;
+    num_elements = 0;
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::allocator_type basic_soa_vector<Policy, Allocator, Ts ...>::get_allocator() const noexcept {
+    return alloc;
+}
+
+/*
+ *
+ * block management, every column gets a block of the same size at once
+ *
+ */
+
+template <typename Policy, typename Allocator, typename ... Ts>
+inline typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type basic_soa_vector<Policy, Allocator, Ts ...>::segment_length(size_type block) const noexcept {
+    const size_type start = block_start(block);
+    if (num_elements <= start) return 0;
+    return num_elements - start < block_size(block) ? num_elements - start : block_size(block);
+}
+
+// raw storage, rows are constructed as they are appended
+template <typename Policy, typename Allocator, typename ... Ts>
+void basic_soa_vector<Policy, Allocator, Ts ...>::allocate_block() {
+    const size_type sz = block_size(num_allocated);
+    block_type &blk = blocks.emplace(num_allocated);
+    try {
+        std::apply([this, sz](Ts * & ... data){
+            ((data = allocate_column<Ts>(sz)), ...);
+        }, blk);
+    } catch (...) {
+        deallocate_block(blk, sz, columns());
+        throw;
+    }
+    ++num_allocated;
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type ... Is>
+void basic_soa_vector<Policy, Allocator, Ts ...>::destroy_rows(const block_type &blk, size_type first, size_type last, std::index_sequence<Is ...>) noexcept {
+    for (size_type i = first; i < last; ++i){
+        (destroy_field(std::get<Is>(blk) + i), ...);
+    }
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type ... Is>
+void basic_soa_vector<Policy, Allocator, Ts ...>::deallocate_block(const block_type &blk, size_type sz, std::index_sequence<Is ...>) noexcept {
+    // a column whose allocation threw is still null and skipped
+    (deallocate_column(std::get<Is>(blk), sz), ...);
+}
+
+// every column draws on alloc rebound to its own type, which keeps its alignment
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename U>
+inline U * basic_soa_vector<Policy, Allocator, Ts ...>::allocate_column(size_type sz) {
+    column_allocator<U> col_alloc(alloc);
+    return column_traits<U>::allocate(col_alloc, sz);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename U>
+inline void basic_soa_vector<Policy, Allocator, Ts ...>::deallocate_column(U * data, size_type sz) noexcept {
+    if (data == nullptr) return;
+    column_allocator<U> col_alloc(alloc);
+    column_traits<U>::deallocate(col_alloc, data, sz);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename U>
+inline void basic_soa_vector<Policy, Allocator, Ts ...>::destroy_field(U * p) noexcept {
+    column_allocator<U> col_alloc(alloc);
+    column_traits<U>::destroy(col_alloc, p);
+}
+
+// builds field I and the ones after it, a throwing field undoes the ones before
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type I, class Refs>
+void basic_soa_vector<Policy, Allocator, Ts ...>::construct_columns(const block_type &blk, size_type offset, Refs &&refs) {
+    if constexpr (I < num_columns){
+        typedef column_type<I> U;
+        column_allocator<U> col_alloc(alloc);
+        U * p = std::get<I>(blk) + offset;
+        column_traits<U>::construct(col_alloc, p, std::get<I>(std::move(refs)));
+        try {
+            construct_columns<I + 1>(blk, offset, std::move(refs));
+        } catch (...) {
+            column_traits<U>::destroy(col_alloc, p);
+            throw;
+        }
+    }
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type ... Is>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::reference basic_soa_vector<Policy, Allocator, Ts ...>::make_row(const block_type &blk, size_type offset, std::index_sequence<Is ...>) noexcept {
+    return reference(std::get<Is>(blk)[offset] ...);
+}
+
+template <typename Policy, typename Allocator, typename ... Ts>
+template <typename basic_soa_vector<Policy, Allocator, Ts ...>::size_type ... Is>
+typename basic_soa_vector<Policy, Allocator, Ts ...>::const_reference basic_soa_vector<Policy, Allocator, Ts ...>::make_const_row(const block_type &blk, size_type offset, std::index_sequence<Is ...>) noexcept {
+    return const_reference(std::get<Is>(blk)[offset] ...);
+}
+
+} // namespace jrd
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef _JRD_SORT_H
+#define _JRD_SORT_H
+
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "vector.h"
+#include "thread_pool.h"
+
+
+/*
+ *
+ * sort and stable_sort for jrd::vector
+ *
+ * Every block is contiguous, so each one is sorted on plain pointers with
+ * std::sort (std::stable_sort), the large blocks cut into chunks first so
+ * all threads of the pool get a share. The chunks of one block are then
+ * merged pairwise in parallel rounds, still on plain pointers.
+ *
+ * That leaves one sorted run per block, which are merged in index order
+ * the way timsort merges its runs: a run is pushed on a stack and the top
+ * runs are merged while the one below is not larger than the two above
+ * it. With doubling blocks every block is as long as all before it, so
+ * this is a cascade where every merge is between equal halves and an
+ * element takes part in two merges on average, with equal blocks it is a
+ * balanced merge tree. These merges cross blocks and run on the vector's
+ * iterators, which only touch the directory at block ends.
+ *
+ * A merge larger than one chunk is itself split across the pool, merge
+ * path style: both runs are moved to a scratch buffer, the output is cut
+ * into chunks, and co_rank finds by binary search where each chunk
+ * starts in either run, so every task merges its own slice of the
+ * inputs into its own slice of the output. That keeps the last merges,
+ * which with doubling blocks cover half of the data each, off a single
+ * thread. With one thread, or a type whose moves can throw, merges stay
+ * in place with std::inplace_merge.
+ *
+ * All merges are between neighbours and keep the left run first on ties,
+ * so stable_sort is stable. Every task works on its own copy of the
+ * comparator.
+ *
+ */
+
+
+namespace jrd{
+namespace detail{
+
+// a sorted range of the vector, data is set while it lies in one block
+template <typename T>
+struct sort_run {
+    T * data;
+    size_t base;
+    size_t size;
+    size_t block;
+};
+
+// one thread sorts whole blocks, more threads get about four chunks each
+inline size_t sort_grain(size_t n, size_t num_threads) noexcept {
+    if (num_threads <= 1) return n;
+    const size_t grain = n / (num_threads * 4);
+    return grain < (size_t(1) << 14) ? size_t(1) << 14 : grain;
+}
+
+/*
+ * how many of the first k elements of the merge of a[0, m) and b[0, n)
+ * come from a, taking from a first on ties like std::merge. The count is
+ * the smallest i with b[k - i - 1] < a[i], found by bisection
+ */
+template <class It, class Compare>
+size_t co_rank(size_t k, It a, size_t m, It b, size_t n, Compare &comp) {
+    size_t lo = k > n ? k - n : 0;
+    size_t hi = k < m ? k : m;
+    while (lo < hi){
+        const size_t i = lo + (hi - lo) / 2;
+        if (comp(b[k - i - 1], a[i])) hi = i;
+        else lo = i + 1;
+    }
+    return lo;
+}
+
+// merges the sorted neighbours [lo, mid) and [mid, hi) of first, on the
+// pool once the merge is larger than grain, see the top of the file
+template <typename T, class It, class Compare>
+void merge_runs(It first, size_t lo, size_t mid, size_t hi, const Compare &comp, thread_pool &pool, size_t grain) {
+    const size_t len = hi - lo;
+    const bool split = pool.size() > 1 && len > grain && lo < mid && mid < hi &&
+                       std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value;
+    if (!split){
+        Compare c(comp);
+        std::inplace_merge(first + static_cast<ptrdiff_t>(lo), first + static_cast<ptrdiff_t>(mid), first + static_cast<ptrdiff_t>(hi), c);
+        return;
+    }
+
+    std::allocator<T> scratch_alloc;
+    T * scratch = std::allocator_traits<std::allocator<T>>::allocate(scratch_alloc, len);
+    const size_t pieces = (len + grain - 1) / grain;
+    auto piece_start = [&](size_t p){ return p * grain < len ? p * grain : len; };
+    pool.run(pieces, [&](size_t p){
+        std::uninitialized_move(first + static_cast<ptrdiff_t>(lo + piece_start(p)), first + static_cast<ptrdiff_t>(lo + piece_start(p + 1)),
+                                scratch + piece_start(p));
+    });
+
+    const size_t m = mid - lo;
+    const size_t n = hi - mid;
+    T * a = scratch;
+    T * b = scratch + m;
+    try {
+        // all the splits first, the merges move out of what the searches read
+        std::unique_ptr<size_t[]> splits(new size_t[pieces + 1]);
+        splits[0] = 0;
+        splits[pieces] = m;
+        pool.run(pieces - 1, [&](size_t p){
+            Compare c(comp);
+            splits[p + 1] = co_rank(piece_start(p + 1), a, m, b, n, c);
+        });
+        pool.run(pieces, [&](size_t p){
+            Compare c(comp);
+            const size_t k0 = piece_start(p);
+            const size_t k1 = piece_start(p + 1);
+            const size_t i0 = splits[p];
+            const size_t i1 = splits[p + 1];
+            std::merge(std::make_move_iterator(a + i0), std::make_move_iterator(a + i1),
+                       std::make_move_iterator(b + (k0 - i0)), std::make_move_iterator(b + (k1 - i1)),
+                       first + static_cast<ptrdiff_t>(lo + k0), c);
+        });
+    } catch (...) {
+        // a throwing comparator leaves the range moved from but valid
+        std::destroy(scratch, scratch + len);
+        std::allocator_traits<std::allocator<T>>::deallocate(scratch_alloc, scratch, len);
+        throw;
+    }
+    std::destroy(scratch, scratch + len);
+    std::allocator_traits<std::allocator<T>>::deallocate(scratch_alloc, scratch, len);
+}
+
+template <typename T, typename Allocator, typename Policy, class Compare, class SortRange>
+void block_sort(vector<T, Allocator, Policy> &vec, Compare comp, thread_pool &pool, SortRange sort_range) {
+    const size_t n = vec.size();
+    if (n < 2) return;
+    const size_t grain = sort_grain(n, pool.size());
+
+    std::vector<sort_run<T>> runs;
+    size_t base = 0;
+    size_t block = 0;
+    for (auto seg : vec.segments()){
+        for (size_t off = 0; off < seg.size(); off += grain){
+            runs.push_back(sort_run<T>{seg.data() + off, base + off, std::min(grain, seg.size() - off), block});
+        }
+        base += seg.size();
+        ++block;
+    }
+
+    pool.run(runs.size(), [&](size_t r){
+        Compare c(comp);
+        sort_range(runs[r].data, runs[r].data + runs[r].size, c);
+    });
+
+    // chunks of the same block are contiguous, merge them pairwise down to one run per block
+    struct pending { size_t run; size_t mid; };
+    for (;;){
+        std::vector<sort_run<T>> merged;
+        std::vector<pending> pairs;
+        for (size_t i = 0; i < runs.size(); ++i){
+            if (i + 1 < runs.size() && runs[i].block == runs[i + 1].block){
+                pairs.push_back(pending{merged.size(), runs[i].size});
+                merged.push_back(sort_run<T>{runs[i].data, runs[i].base, runs[i].size + runs[i + 1].size, runs[i].block});
+                ++i;
+            } else {
+                merged.push_back(runs[i]);
+            }
+        }
+        if (pairs.empty()) break;
+        if (pairs.size() >= pool.size()){
+            pool.run(pairs.size(), [&](size_t p){
+                Compare c(comp);
+                const sort_run<T> &r = merged[pairs[p].run];
+                std::inplace_merge(r.data, r.data + pairs[p].mid, r.data + r.size, c);
+            });
+        } else {
+            // too few pairs to keep the pool busy, split each merge instead
+            for (const pending &pr : pairs){
+                const sort_run<T> &r = merged[pr.run];
+                merge_runs<T>(r.data, 0, pr.mid, r.size, comp, pool, grain);
+            }
+        }
+        runs.swap(merged);
+    }
+
+    // one run per block now, merge them across blocks off a stack of pending runs
+    auto first = vec.begin();
+    std::vector<sort_run<T>> stack;
+    auto merge_at = [&](size_t i){
+        sort_run<T> &lo = stack[i];
+        const sort_run<T> &hi = stack[i + 1];
+        merge_runs<T>(first, lo.base, hi.base, hi.base + hi.size, comp, pool, grain);
+        lo.size += hi.size;
+        stack.erase(stack.begin() + static_cast<ptrdiff_t>(i) + 1);
+    };
+    for (const sort_run<T> &r : runs){
+        stack.push_back(r);
+        while (stack.size() > 1){
+            const size_t k = stack.size();
+            if (k > 2 && stack[k - 3].size <= stack[k - 2].size + stack[k - 1].size){
+                merge_at(stack[k - 3].size < stack[k - 1].size ? k - 3 : k - 2);
+            } else if (stack[k - 2].size <= stack[k - 1].size){
+                merge_at(k - 2);
+            } else {
+                break;
+            }
+        }
+    }
+    while (stack.size() > 1) merge_at(stack.size() - 2);
+}
+
+} // namespace detail
+
+
+// sorts vec by comp, equal elements end up in no particular order
+template <typename T, typename Allocator, typename Policy, class Compare = std::less<T>>
+void sort(vector<T, Allocator, Policy> &vec, Compare comp = Compare(), thread_pool &pool = thread_pool::default_pool()) {
+    detail::block_sort(vec, comp, pool, [](T * lo, T * hi, Compare &c){ std::sort(lo, hi, c); });
+}
+
+// sorts vec by comp, equal elements keep their order
+template <typename T, typename Allocator, typename Policy, class Compare = std::less<T>>
+void stable_sort(vector<T, Allocator, Policy> &vec, Compare comp = Compare(), thread_pool &pool = thread_pool::default_pool()) {
+    detail::block_sort(vec, comp, pool, [](T * lo, T * hi, Compare &c){ std::stable_sort(lo, hi, c); });
+}
+
+} // namespace jrd
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef _JRD_THREAD_POOL_H
+#define _JRD_THREAD_POOL_H
+
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/*
+ *
+ * Small work stealing thread pool used by the parallel algorithms
+ *
+ * Every worker owns a deque of tasks, it pops its own work from the back
+ * and steals from the front of the others when it runs dry. run() is a
+ * fork join: the caller spreads the tasks over the deques, then helps
+ * execute them until all are done, so a pool of size n uses n - 1
+ * workers plus the calling thread and run() can be nested.
+ *
+ */
+
+
+namespace jrd{
+
+class thread_pool {
+    public:
+        typedef size_t size_type;
+
+        explicit thread_pool(size_type num_threads = std::thread::hardware_concurrency());
+        ~thread_pool();
+        thread_pool(const thread_pool &) = delete;
+        thread_pool & operator = (const thread_pool &) = delete;
+
+        // threads that execute tasks, including the one calling run()
+        size_type size() const noexcept;
+
+        // calls f(i) for every i in [0, num_tasks) and returns once all have finished
+        template <class Function>
+        void run(size_type num_tasks, Function f);
+
+        static thread_pool & default_pool();
+
+    private:
+        typedef std::function<void()> task_type;
+
+        struct worker_queue {
+            worker_queue() : lock(), tasks() {}
+
+            std::mutex lock;
+            std::deque<task_type> tasks;
+        };
+
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> workers;
+
+        std::atomic<size_type> queued;
+        std::atomic<size_type> next_queue;
+        std::mutex sleep_lock;
+        std::condition_variable wake;
+        bool stopping;
+
+        void push(size_type queue, task_type task);
+        bool pop(size_type queue, task_type &task);
+        bool steal(size_type thief, task_type &task);
+        void worker_loop(size_type self);
+};
+
+
+inline thread_pool::thread_pool(size_type num_threads)
+    : queues(), workers(), queued(0), next_queue(0), sleep_lock(), wake(), stopping(false) {
+    if (num_threads == 0) num_threads = 1;
+    for (size_type i = 0; i < num_threads; ++i){
+        queues.emplace_back(new worker_queue());
+    }
+    // queue 0 belongs to whoever calls run(), the workers own the rest
+    for (size_type i = 1; i < num_threads; ++i){
+        workers.emplace_back(&thread_pool::worker_loop, this, i);
+    }
+}
+
+inline thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &w : workers) w.join();
+}
+
+inline thread_pool::size_type thread_pool::size() const noexcept {
+    return queues.size();
+}
+
+inline thread_pool & thread_pool::default_pool() {
+    static thread_pool pool;
+    return pool;
+}
+
+inline void thread_pool::push(size_type queue, task_type task) {
+    {
+        std::lock_guard<std::mutex> guard(queues[queue]->lock);
+        queues[queue]->tasks.push_back(std::move(task));
+    }
+    {
+        // taken so a worker between its empty check and its wait cannot miss the wake up
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+    wake.notify_one();
+}
+
+inline bool thread_pool::pop(size_type queue, task_type &task) {
+    std::lock_guard<std::mutex> guard(queues[queue]->lock);
+    if (queues[queue]->tasks.empty()) return false;
+    task = std::move(queues[queue]->tasks.back());
+    queues[queue]->tasks.pop_back();
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+inline bool thread_pool::steal(size_type thief, task_type &task) {
+    const size_type n = queues.size();
+    for (size_type i = 1; i < n; ++i){
+        worker_queue &victim = *queues[(thief + i) % n];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+inline void thread_pool::worker_loop(size_type self) {
+    task_type task;
+    while (true){
+        if (pop(self, task) || steal(self, task)){
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        wake.wait(guard, [&]{ return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping && queued.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+template <class Function>
+void thread_pool::run(size_type num_tasks, Function f) {
+    if (num_tasks == 0) return;
+    if (queues.size() == 1 || num_tasks == 1){
+        for (size_type i = 0; i < num_tasks; ++i) f(i);
+        return;
+    }
+
+    struct join_state {
+        explicit join_state(size_type n) : remaining(n), lock(), done(), error() {}
+
+        std::atomic<size_type> remaining;
+        std::mutex lock;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<join_state>(num_tasks);
+
+    // deal the tasks out round robin, starting at a rotating queue so
+    // concurrent callers do not all pile onto the same workers
+    const size_type n = queues.size();
+    const size_type first = next_queue.fetch_add(1, std::memory_order_relaxed);
+    for (size_type i = 0; i < num_tasks; ++i){
+        push((first + i) % n, [state, &f, i]{
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(state->lock);
+                if (!state->error) state->error = std::current_exception();
+            }
+            if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                std::lock_guard<std::mutex> guard(state->lock);
+                state->done.notify_all();
+            }
+        });
+    }
+
+    // help out until every task of this run has been picked up
+    task_type task;
+    while (state->remaining.load(std::memory_order_acquire) != 0){
+        if (pop(0, task) || steal(0, task)){
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(state->lock);
+        state->done.wait(guard, [&]{ return state->remaining.load(std::memory_order_acquire) == 0; });
+    }
+
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+} // namespace jrd
+
+#endif
@@ -3,11 +3,15 @@
 
 #include <cstddef>
 #include <cstring>
+#include <algorithm>
 #include <utility>
 #include <iterator>
 #include <stdexcept>
-#include <cmath>
-#include <vector>
+#include <limits>
+#include <memory>
+#include <atomic>
+#include <type_traits>
+#include "growth_policy.h"
 
 
 /*
@@ -17,8 +21,12 @@
  * I accomplish this by using a vector of pointers to array that grow
  * by powers of two when the existing storage fills up
  * 
- * random access O(1) block = floor(log(i)), block index = i % floor(log(i))
+ * random access O(1) block = msb(i) - log_offset, offset = i - block start
  * No reallocations happen ever at expense of code complexity
+ * The block sizes come from the Policy parameter, see growth_policy.h
+ * 
+ * Appends only ever write past the last element, so a copy shares every
+ * block of the source and a block is only cloned when it is written to
  * 
  */
 
@@ -32,7 +40,23 @@
 
 namespace jrd{
 
-template <typename T>
+/*
+ * what vector::memory() reports, in bytes unless named otherwise. A block
+ * shared with a copy counts in full for every vector holding it
+ */
+struct memory_stats {
+    size_t bytes_allocated;     // blocks and block directory held on the heap
+    size_t bytes_live;          // size() * sizeof(T)
+    size_t tail_slack;          // unused end of the tail block
+    size_t spare_bytes;         // blocks past the tail, spare or reserved
+    size_t num_blocks;          // blocks holding elements
+    size_t num_allocated;       // blocks allocated, spare and reserved included
+    size_t allocations;         // block allocations over the vector's life
+    size_t deallocations;       // block frees over the vector's life
+    size_t peak_bytes;          // largest bytes_allocated so far
+};
+
+template <typename T, typename Allocator = std::allocator<T>, typename Policy = doubling_growth<>>
 class vector {
     public:
         typedef T                                     value_type;
@@ -40,47 +64,75 @@ class vector {
         typedef const T &                             const_reference;
         typedef T *                                   pointer;
         typedef const T *                             const_pointer;
-        typedef T *                                   iterator;
-        typedef const T *                             const_iterator;
-        typedef std::reverse_iterator<iterator>       reverse_iterator;
-        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
         typedef ptrdiff_t                             difference_type;
         typedef size_t                                size_type;
+        typedef Allocator                             allocator_type;
+        typedef Policy                                growth_policy;
+
+        template <bool is_const>
+        class segment_iterator;
+
+        template <typename U>
+        struct basic_segment;
+        template <bool is_const>
+        class segment_range;
+
+        typedef basic_segment<T>                      segment;
+        typedef basic_segment<const T>                const_segment;
+        typedef segment_iterator<false>               iterator;
+        typedef segment_iterator<true>                const_iterator;
+        typedef std::reverse_iterator<iterator>       reverse_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
 
         vector() noexcept;
+        explicit vector(const allocator_type &) noexcept;
         explicit vector(size_type n);
         vector(size_type n, const T &val);
-        vector(typename vector<T>::iterator first, typename vector<T>::iterator last);
+        template <class InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        vector(InputIt first, InputIt last);
         vector(std::initializer_list<T>);
-        vector(const vector<T> &);
-        vector(vector<T> &&) noexcept;
+        vector(const vector &);
+        vector(vector &&) noexcept;
         ~vector();
-        vector<T> & operator = (const vector<T> &);
-        vector<T> & operator = (vector<T> &&);
-        vector<T> & operator = (std::initializer_list<T>);
+        vector & operator = (const vector &);
+        vector & operator = (vector &&);
+        vector & operator = (std::initializer_list<T>);
 
 
-        iterator begin() noexcept;
+        // the mutable accessors clone any block still shared with a copy,
+        // see unshare(), so unlike the const ones they can throw
+        iterator begin();
+        const_iterator begin() const noexcept;
         const_iterator cbegin() const noexcept;
-        iterator end() noexcept;
+        iterator end();
+        const_iterator end() const noexcept;
         const_iterator cend() const noexcept;
-        reverse_iterator rbegin() noexcept;
+        reverse_iterator rbegin();
         const_reverse_iterator crbegin() const noexcept;
-        reverse_iterator rend() noexcept;
+        reverse_iterator rend();
         const_reverse_iterator crend() const noexcept;
 
 
+        segment_range<false> segments();
+        segment_range<true> segments() const noexcept;
+        template <class Function>
+        void for_each_segment(Function f);
+        template <class Function>
+        void for_each_segment(Function f) const;
+
+
         bool empty() const noexcept;
         size_type size() const noexcept;
         size_type capacity() const noexcept;
         void resize(size_type);
         void resize(size_type, const T &);
         void reserve(size_type);
+        void reserve(size_type, bool prefault);
         void shrink_to_fit();
 
 
         reference operator [](size_type);
-        const_reference operator [](size_type) const;
+        const_reference operator [](size_type) const noexcept;
         reference at(size_type);
         const_reference at(size_type) const;
         reference front();
@@ -96,355 +148,1367 @@ class vector {
         void pop_back();
 
 
-        void swap(vector<T> &);
+        // bulk appends, filled a whole block at a time
+        template <class InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        void append(InputIt first, InputIt last);
+        void append(const T * data, size_type n);
+        segment_range<false> grow_by(size_type n);
+
+
+        // out[k] = (*this)[indices[k]], and the other way round for
+        // scatter, for k < n. Every index must be below size(), like []
+        void gather(const size_type * indices, size_type n, T * out) const;
+        void scatter(const size_type * indices, size_type n, const T * values);
+
+
+        void swap(vector &);
         void clear() noexcept;
 
-        bool operator == (const vector<T> &) const;
-        bool operator != (const vector<T> &) const;
+        // a copy made in O(blocks), same as the copy constructor
+        vector snapshot() const;
+        allocator_type get_allocator() const noexcept;
+
+        // only with a policy that tracks memory, see with_memory_stats
+        memory_stats memory() const noexcept;
+
+        bool operator == (const vector &) const;
+        bool operator != (const vector &) const;
     private:
-        struct block_type{
-            block_type() noexcept;
-            ~block_type();
-            block_type(const size_type in_size);
-            block_type(const T * in_data, const size_type in_size) noexcept;
-            block_type(const block_type & other) = delete;
-            block_type(block_type && other) noexcept;
-            block_type & operator=(const block_type & other) = delete;
-            block_type & operator=(block_type && other) noexcept;
+        // a block held by more than one vector. shared_len is how many of
+        // its elements the copies can see, the source may append past it
+        struct block_share {
+            std::atomic<size_type> refs;
+            std::atomic<size_type> shared_len;
+        };
 
+        // raw storage owned by the vector, allocated and freed through its
+        // allocator, the size of block b is block_size(b)
+        struct block_type{
             T * data;
-            size_type size;
         };
 
-        static constexpr size_type initial_size = 16;
-        static constexpr size_type log_offset = static_cast<size_type>(log2(static_cast<float>(initial_size))) - 1;
-        static constexpr size_type growth_factor = 2;
+        typedef block_location location_type;
+        typedef std::allocator_traits<allocator_type> alloc_traits;
+        typedef typename alloc_traits::template rebind_alloc<block_type> directory_allocator;
+        typedef typename alloc_traits::template rebind_alloc<block_share> share_allocator;
+        typedef typename alloc_traits::template rebind_alloc<block_share *> share_table_allocator;
+
+        /*
+         * the share count of every block, kept beside the directory so a
+         * directory slot stays one pointer. It is allocated the first time
+         * the vector takes part in a copy and grows like the heap
+         * directory. A slot is null while its block is private, blocks
+         * past length are private
+         */
+        struct share_table {
+            block_share ** slots = nullptr;
+            size_type length = 0;
+
+            block_share * operator [](size_type b) const noexcept { return b < length ? slots[b] : nullptr; }
+
+            void ensure(size_type n, const allocator_type &owner_alloc) {
+                if (n <= length) return;
+                size_type grown = length == 0 ? 8 : length * 2;
+                if (grown < n) grown = n;
+                share_table_allocator table_alloc(owner_alloc);
+                block_share ** fresh = std::allocator_traits<share_table_allocator>::allocate(table_alloc, grown);
+                for (size_type b = 0; b < grown; ++b) fresh[b] = b < length ? slots[b] : nullptr;
+                release(owner_alloc);
+                slots = fresh;
+                length = grown;
+            }
+
+            void release(const allocator_type &owner_alloc) noexcept {
+                if (slots == nullptr) return;
+                share_table_allocator table_alloc(owner_alloc);
+                std::allocator_traits<share_table_allocator>::deallocate(table_alloc, slots, length);
+                slots = nullptr;
+                length = 0;
+            }
+
+            // the allocators compare equal
+            void take(share_table &other, const allocator_type &owner_alloc) noexcept {
+                release(owner_alloc);
+                slots = other.slots;
+                length = other.length;
+                other.slots = nullptr;
+                other.length = 0;
+            }
+        };
+
+        /*
+         * the block directory, policies that bound the number of blocks
+         * get it inline sized for every block a size_type index can reach,
+         * so it never reallocates. Unbounded ones keep it on the heap and
+         * double it when it fills, like the map of a std::deque.
+         */
+        template <bool bounded, typename = void>
+        struct directory_type {
+            // slots at or past num_allocated are never read, so they are
+            // left uninitialized instead of zeroing the whole array
+            directory_type() noexcept {}
+            directory_type(const directory_type &) = delete;
+            directory_type & operator = (const directory_type &) = delete;
+
+            block_type slots[Policy::max_blocks];
+
+            block_type & operator [](size_type b) noexcept { return slots[b]; }
+            const block_type & operator [](size_type b) const noexcept { return slots[b]; }
+            void ensure(size_type, allocator_type &) {}
+            void release(allocator_type &) noexcept {}
+            size_type heap_bytes() const noexcept { return 0; }
+
+            void take(directory_type &other, size_type n, allocator_type &) noexcept {
+                for (size_type b = 0; b < n; ++b) slots[b] = other.slots[b];
+            }
+        };
 
+        template <typename Dummy>
+        struct directory_type<false, Dummy> {
+            block_type * slots = nullptr;
+            size_type length = 0;
+
+            block_type & operator [](size_type b) noexcept { return slots[b]; }
+            const block_type & operator [](size_type b) const noexcept { return slots[b]; }
+            size_type heap_bytes() const noexcept { return length * sizeof(block_type); }
+
+            void ensure(size_type n, allocator_type &owner_alloc) {
+                if (n <= length) return;
+                size_type grown = length == 0 ? 8 : length * 2;
+                if (grown < n) grown = n;
+                directory_allocator dir_alloc(owner_alloc);
+                block_type * fresh = std::allocator_traits<directory_allocator>::allocate(dir_alloc, grown);
+                for (size_type b = 0; b < grown; ++b){
+                    ::new (static_cast<void *>(fresh + b)) block_type(b < length ? slots[b] : block_type());
+                }
+                release(owner_alloc);
+                slots = fresh;
+                length = grown;
+            }
+
+            void release(allocator_type &owner_alloc) noexcept {
+                if (slots == nullptr) return;
+                directory_allocator dir_alloc(owner_alloc);
+                std::allocator_traits<directory_allocator>::deallocate(dir_alloc, slots, length);
+                slots = nullptr;
+                length = 0;
+            }
+
+            // the directory memory changes hands, the allocators compare equal
+            void take(directory_type &other, size_type, allocator_type &owner_alloc) noexcept {
+                release(owner_alloc);
+                slots = other.slots;
+                length = other.length;
+                other.slots = nullptr;
+                other.length = 0;
+            }
+        };
 
-        size_type num_elements = 0;
+        /*
+         * the element count. Under single_writer it is stored with release
+         * after the elements are built and size() loads it with acquire, so
+         * a reader that sees n also sees the first n elements and the
+         * directory slots of their blocks. Only the writer stores, so a
+         * load and a store do for an increment.
+         */
+        template <bool is_published, typename = void>
+        struct count_type {
+            size_type value = 0;
+
+            operator size_type() const noexcept { return value; }
+            size_type acquire() const noexcept { return value; }
+            count_type & operator = (size_type v) noexcept { value = v; return *this; }
+            count_type & operator += (size_type v) noexcept { value += v; return *this; }
+            count_type & operator ++ () noexcept { ++value; return *this; }
+            count_type & operator -- () noexcept { --value; return *this; }
+        };
+
+        template <typename Dummy>
+        struct count_type<true, Dummy> {
+            std::atomic<size_type> value{0};
+
+            count_type() noexcept {}
+            count_type(const count_type &) = delete;
+            count_type & operator = (const count_type &other) noexcept { return *this = size_type(other); }
+
+            operator size_type() const noexcept { return value.load(std::memory_order_relaxed); }
+            size_type acquire() const noexcept { return value.load(std::memory_order_acquire); }
+            count_type & operator = (size_type v) noexcept { value.store(v, std::memory_order_release); return *this; }
+            count_type & operator += (size_type v) noexcept { return *this = size_type(*this) + v; }
+            count_type & operator ++ () noexcept { return *this += 1; }
+            count_type & operator -- () noexcept { return *this = size_type(*this) - 1; }
+        };
+
+
+        count_type<Policy::concurrent_reads> num_elements;
         size_type next_free_index = 0;
+        size_type num_blocks = 0;
+        size_type num_allocated = 0;    // blocks past num_blocks are reserved and empty
+        size_type tail_size = 0;
+        mutable size_type num_shared = 0;   // blocks that carry a share count
+
+        // allocator traffic for memory(), nothing at all unless the policy
+        // asks. Empty it packs in next to an empty allocator
+        template <bool is_tracked, typename = void>
+        struct memory_counters {
+            size_type allocations = 0;
+            size_type deallocations = 0;
+            size_type peak_bytes = 0;
+        };
+
+        template <typename Dummy>
+        struct memory_counters<false, Dummy> {};
+
+        allocator_type alloc;
+        memory_counters<Policy::track_memory> counters;
+
+        directory_type<Policy::bounded> blocks;
+        // a const copy of the vector shares the blocks of the source too, hence mutable
+        mutable share_table shares;
+
+        // storage for block 0 inside the object when the policy asks for it
+        template <bool is_inline, typename = void>
+        struct first_block_type {
+            // left uninitialized, slots are constructed as they are used
+            first_block_type() noexcept {}
+            first_block_type(const first_block_type &) = delete;
+            first_block_type & operator = (const first_block_type &) = delete;
+
+            alignas(T) unsigned char bytes[Policy::block_size(0) * sizeof(T)];
 
-        std::vector<block_type> blocks;
+            T * data() noexcept { return reinterpret_cast<T *>(bytes); }
+            bool holds(const T * p) const noexcept { return static_cast<const void *>(p) == static_cast<const void *>(bytes); }
+        };
+
+        template <typename Dummy>
+        struct first_block_type<false, Dummy> {
+            T * data() noexcept { return nullptr; }
+            bool holds(const T *) const noexcept { return false; }
+        };
+
+        first_block_type<Policy::inline_first> first_block;
 
         inline void allocate_new_block();
+        void drop_empty_tail() noexcept;
+        block_type provision_block(size_type b);
+        block_type allocate_block(size_type sz);
+        T * allocate_storage(size_type sz);
+        void deallocate_storage(T * data, size_type sz) noexcept;
+        size_type footprint() const noexcept;
+        void release_block(size_type b, size_type live) noexcept;
+        void trim_blocks(size_type keep) noexcept;
+
+        block_share * share_block(size_type b) const;
+        __attribute__((noinline)) void unshare(size_type b);
+        __attribute__((noinline)) void unshare_all();
+        void release_shared(block_type &blk, size_type b, size_type live) noexcept;
+        inline void detach();
+        void copy_from(const vector &other);
+        void steal(vector &other) noexcept;
+
+        static inline location_type locate(size_type idx) noexcept;
+        static constexpr size_type block_start(size_type block) noexcept;
+        static constexpr size_type block_size(size_type block) noexcept;
+        inline iterator make_iterator(size_type idx) const noexcept;
+        static inline T * empty_slot() noexcept;
+        inline size_type num_segments() const noexcept;
+        inline size_type segment_length(size_type block) const noexcept;
+        inline reference unchecked_at(size_type idx);
+        inline const_reference unchecked_at(size_type idx) const noexcept;
+        template <class ForwardIt>
+        void append_n(ForwardIt first, size_type n);
+        static constexpr size_type prefetch_distance = 32;
+        template <bool for_write, class Visit>
+        void prefetched_walk(const size_type * indices, size_type n, Visit visit) const;
+
+    public:
+        /*
+         * iterates one block at a time: ++ is a pointer bump that only
+         * touches the block directory when cur runs into last, jumps
+         * (+=, -, []) go back through locate()
+         */
+        template <bool is_const>
+        class segment_iterator {
+            public:
+                typedef std::random_access_iterator_tag                      iterator_category;
+                typedef T                                                    value_type;
+                typedef ptrdiff_t                                            difference_type;
+                typedef typename std::conditional<is_const, const T *, T *>::type pointer;
+                typedef typename std::conditional<is_const, const T &, T &>::type reference;
+
+                segment_iterator() noexcept : owner(nullptr), block(0), cur(empty_slot()), last(empty_slot()) {}
+                segment_iterator(const vector * in_owner, size_type in_block, T * in_cur, T * in_last) noexcept
+                    : owner(in_owner), block(in_block), cur(in_cur), last(in_last) {}
+
+                // iterator -> const_iterator
+                template <bool other_const, typename = typename std::enable_if<is_const && !other_const>::type>
+                segment_iterator(const segment_iterator<other_const> & other) noexcept
+                    : owner(other.owner), block(other.block), cur(other.cur), last(other.last) {}
+
+                reference operator * () const noexcept { return *cur; }
+                pointer operator -> () const noexcept { return cur; }
+                reference operator [](difference_type n) const noexcept { return *(*this + n); }
+
+                segment_iterator & operator ++ () noexcept {
+                    if (++cur == last && block + 1 < owner->num_blocks) {
+                        ++block;
+                        cur = owner->blocks[block].data;
+                        last = cur + block_size(block);
+                    }
+                    return *this;
+                }
+
+                segment_iterator operator ++ (int) noexcept {
+                    segment_iterator tmp(*this);
+                    ++*this;
+                    return tmp;
+                }
+
+                segment_iterator & operator -- () noexcept {
+                    if (cur == owner->blocks[block].data && block > 0) {
+                        --block;
+                        last = owner->blocks[block].data + block_size(block);
+                        cur = last;
+                    }
+                    --cur;
+                    return *this;
+                }
+
+                segment_iterator operator -- (int) noexcept {
+                    segment_iterator tmp(*this);
+                    --*this;
+                    return tmp;
+                }
+
+                segment_iterator & operator += (difference_type n) noexcept {
+                    if (n >= 0 && n < last - cur) {
+                        cur += n;
+                    } else {
+                        *this = owner->make_iterator(static_cast<size_type>(static_cast<difference_type>(index()) + n));
+                    }
+                    return *this;
+                }
+
+                segment_iterator & operator -= (difference_type n) noexcept { return *this += -n; }
+
+                segment_iterator operator + (difference_type n) const noexcept {
+                    segment_iterator tmp(*this);
+                    return tmp += n;
+                }
+
+                friend segment_iterator operator + (difference_type n, const segment_iterator & it) noexcept { return it + n; }
+
+                segment_iterator operator - (difference_type n) const noexcept {
+                    segment_iterator tmp(*this);
+                    return tmp -= n;
+                }
+
+                template <bool other_const>
+                difference_type operator - (const segment_iterator<other_const> & rhs) const noexcept {
+                    return static_cast<difference_type>(index()) - static_cast<difference_type>(rhs.index());
+                }
+
+                template <bool other_const>
+                bool operator == (const segment_iterator<other_const> & rhs) const noexcept { return cur == rhs.cur; }
+                template <bool other_const>
+                bool operator != (const segment_iterator<other_const> & rhs) const noexcept { return cur != rhs.cur; }
+                template <bool other_const>
+                bool operator < (const segment_iterator<other_const> & rhs) const noexcept { return index() < rhs.index(); }
+                template <bool other_const>
+                bool operator > (const segment_iterator<other_const> & rhs) const noexcept { return index() > rhs.index(); }
+                template <bool other_const>
+                bool operator <= (const segment_iterator<other_const> & rhs) const noexcept { return index() <= rhs.index(); }
+                template <bool other_const>
+                bool operator >= (const segment_iterator<other_const> & rhs) const noexcept { return index() >= rhs.index(); }
+
+                // position of the iterator in the vector
+                size_type index() const noexcept {
+                    // a default constructed iterator, or one into an empty vector
+                    if (cur == empty_slot()) return 0;
+                    return block_start(block) + static_cast<size_type>(cur - owner->blocks[block].data);
+                }
+
+            private:
+                template <bool> friend class segment_iterator;
+
+                const vector * owner;
+                size_type block;
+                T * cur;
+                T * last;
+        };
+
+        /*
+         * the populated prefix of one block, every element in [first, last)
+         * is contiguous so loops over a segment vectorize like loops over
+         * a plain array
+         */
+        template <typename U>
+        struct basic_segment {
+            U * first;
+            U * last;
+
+            U * begin() const noexcept { return first; }
+            U * end() const noexcept { return last; }
+            U * data() const noexcept { return first; }
+            size_type size() const noexcept { return static_cast<size_type>(last - first); }
+            bool empty() const noexcept { return first == last; }
+        };
+
+        /*
+         * forward range over the segments covering the indices [lo, hi),
+         * one per block, cut down at both ends to the part inside the range
+         */
+        template <bool is_const>
+        class segment_range {
+            public:
+                typedef typename std::conditional<is_const, const_segment, segment>::type value_type;
+
+                class iterator {
+                    public:
+                        typedef std::forward_iterator_tag iterator_category;
+                        typedef typename segment_range::value_type value_type;
+                        typedef ptrdiff_t difference_type;
+                        typedef const value_type * pointer;
+                        typedef value_type reference;
+
+                        iterator(const vector * in_owner, size_type in_block, size_type in_lo, size_type in_hi) noexcept
+                            : owner(in_owner), block(in_block), lo(in_lo), hi(in_hi) {}
+
+                        value_type operator * () const noexcept {
+                            const block_type & blk = owner->blocks[block];
+                            const size_type start = block_start(block);
+                            const size_type first = lo > start ? lo - start : 0;
+                            const size_type last = hi - start < block_size(block) ? hi - start : block_size(block);
+                            return value_type{blk.data + first, blk.data + last};
+                        }
+
+                        iterator & operator ++ () noexcept { ++block; return *this; }
+                        iterator operator ++ (int) noexcept { iterator tmp(*this); ++block; return tmp; }
+                        bool operator == (const iterator & rhs) const noexcept { return block == rhs.block; }
+                        bool operator != (const iterator & rhs) const noexcept { return block != rhs.block; }
+
+                    private:
+                        const vector * owner;
+                        size_type block;
+                        size_type lo;
+                        size_type hi;
+                };
+
+                segment_range(const vector * in_owner, size_type in_lo, size_type in_hi) noexcept
+                    : owner(in_owner), lo(in_lo), hi(in_hi),
+                      first_block(in_lo < in_hi ? locate(in_lo).block : 0),
+                      last_block(in_lo < in_hi ? locate(in_hi - 1).block + 1 : 0) {}
+
+                iterator begin() const noexcept { return iterator(owner, first_block, lo, hi); }
+                iterator end() const noexcept { return iterator(owner, last_block, lo, hi); }
+                size_type size() const noexcept { return last_block - first_block; }
+                value_type operator [](size_type n) const noexcept { return *iterator(owner, first_block + n, lo, hi); }
+
+            private:
+                const vector * owner;
+                size_type lo;
+                size_type hi;
+                size_type first_block;
+                size_type last_block;
+        };
 };
 
 
-template <typename T>
-vector<T>::vector() noexcept : blocks(){
-    blocks.emplace_back(initial_size);
-}
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy>::vector() noexcept : vector(allocator_type()) {}
+
+// nothing is allocated until the first element goes in
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy>::vector(const allocator_type &in_alloc) noexcept : num_elements(), alloc(in_alloc), counters(), blocks(), shares(), first_block() {}
 
-template <typename T>
-vector<T>::vector(typename vector<T>::size_type n) {
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy>::vector(typename vector<T, Allocator, Policy>::size_type n) {
 }
 
-template <typename T>
-vector<T>::vector(typename vector<T>::size_type n, const T &value) {
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy>::vector(typename vector<T, Allocator, Policy>::size_type n, const T &value) {
     // TODO
 }
 
-template <typename T>
-vector<T>::vector(vector<T>::iterator first, vector<T>::iterator last) {
-    while(first != last){
-        push_back(*first);
-        ++first;
-    }
+template <typename T, typename Allocator, typename Policy>
+template <class InputIt, typename>
+vector<T, Allocator, Policy>::vector(InputIt first, InputIt last) : vector() {
+    append(first, last);
 }
 
-template <typename T>
-vector<T>::vector(std::initializer_list<T> lst) {
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy>::vector(std::initializer_list<T> lst) {
     // TODO
 }
 
-template <typename T>
-vector<T>::vector(const vector<T> &other) {
-    *this = other;
+/*
+ * the blocks of other are shared instead of copied, so a copy costs
+ * O(blocks) whatever the size. Whichever vector writes to a shared block
+ * first gets its own clone of it, see unshare(). A reference or iterator
+ * taken from other before the copy must not be written through after it
+ */
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy>::vector(const vector<T, Allocator, Policy> &other)
+    : num_elements(), alloc(alloc_traits::select_on_container_copy_construction(other.alloc)), counters(), blocks(), shares(), first_block() {
+    try {
+        copy_from(other);
+    } catch (...) {
+        clear();
+        blocks.release(alloc);
+        shares.release(alloc);
+        throw;
+    }
 }
 
-template <typename T>
-vector<T>::vector(vector<T> &&other) noexcept {
-    *this = other;
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy>::vector(vector<T, Allocator, Policy> &&other) noexcept : num_elements(), alloc(other.alloc), counters(), blocks(), shares(), first_block() {
+    steal(other);
 }
 
-template <typename T>
-vector<T>::~vector() {
-    // should run block_type dtor and clean up memory
-    blocks.clear();
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy>::~vector() {
+    clear();
+    blocks.release(alloc);
+    shares.release(alloc);
 }
 
-template <typename T>
-vector<T> & vector<T>::operator = (const vector<T> &other) {
-    // TODO
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy> & vector<T, Allocator, Policy>::operator = (const vector<T, Allocator, Policy> &other) {
+    if (this == &other) return *this;
+    clear();
+    if constexpr (alloc_traits::propagate_on_container_copy_assignment::value){
+        blocks.release(alloc);
+        shares.release(alloc);
+        alloc = other.alloc;
+    }
+    try {
+        copy_from(other);
+    } catch (...) {
+        clear();
+        throw;
+    }
     return *this;
 }
 
-template <typename T>
-vector<T> & vector<T>::operator = (vector<T> &&other) {
-    // TODO
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy> & vector<T, Allocator, Policy>::operator = (vector<T, Allocator, Policy> &&other) {
+    if (this == &other) return *this;
+    clear();
+    if (alloc_traits::propagate_on_container_move_assignment::value || alloc == other.alloc){
+        blocks.release(alloc);
+        shares.release(alloc);
+        if constexpr (alloc_traits::propagate_on_container_move_assignment::value) alloc = other.alloc;
+        steal(other);
+    } else {
+        // the memory cannot change hands, move the elements across
+        for (auto seg : other.segments()) append_n(std::make_move_iterator(seg.begin()), seg.size());
+        other.clear();
+    }
     return *this;
 }
 
-template <typename T>
-vector<T> & vector<T>::operator = (std::initializer_list<T> lst) {
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy> & vector<T, Allocator, Policy>::operator = (std::initializer_list<T> lst) {
     // TODO
     return *this;
 }
 
-template <typename T>
-typename vector<T>::iterator vector<T>::begin() noexcept {
-    return 0x0;
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::iterator vector<T, Allocator, Policy>::begin() {
+    detach();
+    return make_iterator(0);
 }
 
-template <typename T>
-typename vector<T>::const_iterator vector<T>::cbegin() const noexcept {
-    return 0x0;
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_iterator vector<T, Allocator, Policy>::begin() const noexcept {
+    return make_iterator(0);
 }
 
-template <typename T>
-typename vector<T>::iterator vector<T>::end() noexcept {
-    return iterator(blocks.back().data[next_free_index]);
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_iterator vector<T, Allocator, Policy>::cbegin() const noexcept {
+    return make_iterator(0);
 }
 
-template <typename T>
-typename vector<T>::const_iterator vector<T>::cend() const noexcept {
-    return 0x0;
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::iterator vector<T, Allocator, Policy>::end() {
+    detach();
+    return make_iterator(num_elements);
 }
 
-template <typename T>
-typename vector<T>::reverse_iterator vector<T>::rbegin() noexcept {
-    return reverse_iterator();
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_iterator vector<T, Allocator, Policy>::end() const noexcept {
+    return make_iterator(num_elements);
 }
 
-template <typename T>
-typename vector<T>::const_reverse_iterator vector<T>::crbegin() const noexcept {
-    return reverse_iterator();
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_iterator vector<T, Allocator, Policy>::cend() const noexcept {
+    return make_iterator(num_elements);
 }
 
-template <typename T>
-typename vector<T>::reverse_iterator vector<T>::rend() noexcept {
-    return reverse_iterator();
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::reverse_iterator vector<T, Allocator, Policy>::rbegin() {
+    return reverse_iterator(end());
 }
 
-template <typename T>
-typename vector<T>::const_reverse_iterator vector<T>::crend() const noexcept {
-    return reverse_iterator();
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_reverse_iterator vector<T, Allocator, Policy>::crbegin() const noexcept {
+    return const_reverse_iterator(cend());
 }
 
-template <typename T>
-bool vector<T>::empty() const noexcept {
-    return num_elements == 0;
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::reverse_iterator vector<T, Allocator, Policy>::rend() {
+    return reverse_iterator(begin());
 }
 
-template <typename T>
-typename vector<T>::size_type vector<T>::size() const noexcept{
-    return num_elements;
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_reverse_iterator vector<T, Allocator, Policy>::crend() const noexcept {
+    return const_reverse_iterator(cbegin());
 }
 
-template <typename T>
-typename vector<T>::size_type vector<T>::capacity() const noexcept {
-    if (blocks.size() == 0) return 0;
-    return (num_elements - next_free_index) + blocks.back().size;
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::template segment_range<false> vector<T, Allocator, Policy>::segments() {
+    detach();
+    return segment_range<false>(this, 0, num_elements);
 }
 
-template <typename T>
-void vector<T>::resize(typename vector<T>::size_type sz) {
-    // TODO
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::template segment_range<true> vector<T, Allocator, Policy>::segments() const noexcept {
+    return segment_range<true>(this, 0, num_elements);
 }
 
-template <typename T>
-void vector<T>::resize(typename vector<T>::size_type sz, const T &c) {
-    // TODO
+template <typename T, typename Allocator, typename Policy>
+template <class Function>
+void vector<T, Allocator, Policy>::for_each_segment(Function f) {
+    detach();
+    const size_type n = num_segments();
+    for (size_type b = 0; b < n; ++b){
+        T * first = blocks[b].data;
+        f(segment{first, first + segment_length(b)});
+    }
 }
 
-template <typename T>
-void vector<T>::reserve(typename vector<T>::size_type _sz) {
+template <typename T, typename Allocator, typename Policy>
+template <class Function>
+void vector<T, Allocator, Policy>::for_each_segment(Function f) const {
+    const size_type n = num_segments();
+    for (size_type b = 0; b < n; ++b){
+        const T * first = blocks[b].data;
+        f(const_segment{first, first + segment_length(b)});
+    }
+}
+
+template <typename T, typename Allocator, typename Policy>
+bool vector<T, Allocator, Policy>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::size_type vector<T, Allocator, Policy>::size() const noexcept{
+    return num_elements.acquire();
+}
+
+// the allocated blocks are always a prefix of the chain, so their total
+// size is where the first unallocated block would start
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::size_type vector<T, Allocator, Policy>::capacity() const noexcept {
+    return block_start(num_allocated);
+}
+
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::resize(typename vector<T, Allocator, Policy>::size_type sz) {
     // TODO
 }
 
-template <typename T>
-void vector<T>::shrink_to_fit() {
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::resize(typename vector<T, Allocator, Policy>::size_type sz, const T &c) {
     // TODO
 }
 
-template <typename T>
-typename vector<T>::reference vector<T>::operator [](typename vector<T>::size_type idx) {
-    if (num_elements == 0 || idx >= num_elements) throw std::out_of_range("index out of range");
-    size_type block = 0;
-    size_type offset = idx;
-    if (idx >= initial_size){
-        block = static_cast<size_type>(log2(static_cast<double>(idx))) - log_offset;
-        offset = idx - blocks[block].size;
-    }
-    return blocks[block].data[offset];  
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::reserve(typename vector<T, Allocator, Policy>::size_type sz) {
+    reserve(sz, false);
 }
 
-template <typename T>
-typename vector<T>::const_reference vector<T>::operator [](typename vector<T>::size_type idx) const {
-    if (num_elements == 0 || idx >= num_elements) throw std::out_of_range("index out of range");
-    size_type block = 0;
-    size_type offset = idx;
-    if (idx >= initial_size){
-        block = static_cast<size_type>(log2(static_cast<double>(idx))) - log_offset;
-        offset = idx - blocks[block].size;
+/*
+ * allocates every block needed to hold sz elements up front, appends then
+ * walk into them without calling the allocator. With prefault set every
+ * page of the new blocks is written once so the page faults happen here
+ * and not on the append path.
+ */
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::reserve(typename vector<T, Allocator, Policy>::size_type sz, bool prefault) {
+    constexpr size_type page_size = 4096;
+    while (block_start(num_allocated) < sz){
+        blocks.ensure(num_allocated + 1, alloc);
+        blocks[num_allocated] = provision_block(num_allocated);
+        if (prefault){
+            // raw storage, nothing lives here yet
+            volatile char * bytes = reinterpret_cast<volatile char *>(blocks[num_allocated].data);
+            const size_type num_bytes = block_size(num_allocated) * sizeof(T);
+            for (size_type off = 0; off < num_bytes; off += page_size) bytes[off] = 0;
+        }
+        ++num_allocated;
     }
-    return blocks[block].data[offset];  
 }
 
-template <typename T>
-typename vector<T>::reference vector<T>::at(size_type pos) {
-    if (num_elements == 0 || pos >= num_elements) throw std::out_of_range("index out of range");
-    size_type block = 0;
-    size_type offset = pos;
-    if (pos >= initial_size){
-        block = static_cast<size_type>(log2(static_cast<double>(pos))) - log_offset;
-        offset = pos - blocks[block].size;
-    }
-    return blocks[block].data[offset];  
+// every block past the tail goes back, spare and reserved alike. The
+// elements never move so the tail block keeps its full size
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::shrink_to_fit() {
+    trim_blocks(num_blocks);
+    if (num_blocks == 0) blocks.release(alloc);
 }
 
-template <typename T>
-typename vector<T>::const_reference vector<T>::at(size_type pos) const {
-    if (num_elements == 0 || pos >= num_elements) throw std::out_of_range("index out of range");
-    size_type block = 0;
-    size_type offset = pos;
-    if (pos >= initial_size){
-        block = static_cast<size_type>(log2(static_cast<double>(pos))) - log_offset;
-        offset = pos - blocks[block].size;
-    }
-    return blocks[block].data[offset];  
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::reference vector<T, Allocator, Policy>::operator [](typename vector<T, Allocator, Policy>::size_type idx) {
+    return unchecked_at(idx);
 }
 
-template <typename T>
-typename vector<T>::reference vector<T>::front() {
-    if (blocks.size() == 0) throw std::out_of_range("no elements in jrd::vector");
-    return blocks[0].data[0];
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_reference vector<T, Allocator, Policy>::operator [](typename vector<T, Allocator, Policy>::size_type idx) const noexcept {
+    return unchecked_at(idx);
 }
 
-template <typename T>
-typename vector<T>::const_reference vector<T>::front() const {
-    if (blocks.size() == 0) throw std::out_of_range("no elements in jrd::vector");
-    return blocks[0].data[0];
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::reference vector<T, Allocator, Policy>::at(size_type pos) {
+    if (pos >= size()) throw std::out_of_range("index out of range");
+    return unchecked_at(pos);
 }
 
-template <typename T>
-typename vector<T>::reference vector<T>::back() {
-    // TODO 
-    if (blocks.size() == 0) throw std::out_of_range("no elements in jrd::vector");
-    throw std::runtime_error(" NOT IMPLEMENTED ");
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_reference vector<T, Allocator, Policy>::at(size_type pos) const {
+    if (pos >= size()) throw std::out_of_range("index out of range");
+    return unchecked_at(pos);
+}
+
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::reference vector<T, Allocator, Policy>::front() {
+    if (size_type(num_elements) == 0) throw std::out_of_range("no elements in jrd::vector");
+    if (__builtin_expect(num_shared != 0, 0) && shares[0] != nullptr) unshare(0);
     return blocks[0].data[0];
 }
 
-template <typename T>
-typename vector<T>::const_reference vector<T>::back() const {
-    // TODO 
-    if (blocks.size() == 0) throw std::out_of_range("no elements in jrd::vector");
-    throw std::runtime_error(" NOT IMPLEMENTED ");
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_reference vector<T, Allocator, Policy>::front() const {
+    if (size_type(num_elements) == 0) throw std::out_of_range("no elements in jrd::vector");
     return blocks[0].data[0];
 }
 
-template <typename T>
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::reference vector<T, Allocator, Policy>::back() {
+    if (size_type(num_elements) == 0) throw std::out_of_range("no elements in jrd::vector");
+    if (__builtin_expect(num_shared != 0, 0) && shares[num_blocks - 1] != nullptr) unshare(num_blocks - 1);
+    return blocks[num_blocks - 1].data[next_free_index - 1];
+}
+
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::const_reference vector<T, Allocator, Policy>::back() const {
+    if (size_type(num_elements) == 0) throw std::out_of_range("no elements in jrd::vector");
+    return blocks[num_blocks - 1].data[next_free_index - 1];
+}
+
+// the element is built straight into its slot, and only counted once its
+// constructor has returned. A throw leaves the vector unchanged, a block
+// opened for the element is kept as the spare
+template <typename T, typename Allocator, typename Policy>
 template <class ... Args>
-inline void vector<T>::emplace_back(Args && ... args) {
-    if (next_free_index == blocks.back().size) allocate_new_block();
-    blocks.back().data[next_free_index++] = std::move( T( std::forward<Args>(args) ... ) );
+inline void vector<T, Allocator, Policy>::emplace_back(Args && ... args) {
+    if (next_free_index == tail_size) allocate_new_block();
+    try {
+        alloc_traits::construct(alloc, blocks[num_blocks - 1].data + next_free_index, std::forward<Args>(args) ...);
+    } catch (...) {
+        drop_empty_tail();
+        throw;
+    }
+    ++next_free_index;
     ++num_elements;
 }
 
-template <typename T>
-inline void vector<T>::push_back(const T &val) {
-    if (next_free_index == blocks.back().size) allocate_new_block();
-    blocks.back().data[next_free_index++] = val;
-    ++num_elements;
+template <typename T, typename Allocator, typename Policy>
+inline void vector<T, Allocator, Policy>::push_back(const T &val) {
+    emplace_back(val);
 }
 
-template <typename T>
-inline void vector<T>::push_back(T &&val) {
-    if (next_free_index == blocks.back().size) allocate_new_block();
-    blocks.back().data[next_free_index++] = val;
-    ++num_elements;
+template <typename T, typename Allocator, typename Policy>
+inline void vector<T, Allocator, Policy>::push_back(T &&val) {
+    emplace_back(std::move(val));
 }
 
-template <typename T>
-void vector<T>::pop_back() {
-    // TODO 
+template <typename T, typename Allocator, typename Policy>
+template <class InputIt, typename>
+void vector<T, Allocator, Policy>::append(InputIt first, InputIt last) {
+    typedef typename std::iterator_traits<InputIt>::iterator_category category;
+    if constexpr (std::is_pointer<InputIt>::value && std::is_same<typename std::remove_cv<typename std::remove_pointer<InputIt>::type>::type, T>::value){
+        append(first, static_cast<size_type>(last - first));
+    } else if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value){
+        append_n(first, static_cast<size_type>(std::distance(first, last)));
+    } else {
+        // single pass, the length is not known up front
+        for (; first != last; ++first) emplace_back(*first);
+    }
 }
 
-template <typename T>
-void vector<T>::swap(vector<T> &rhs) {
-    // TODO 
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::append(const T * data, size_type n) {
+    if constexpr (std::is_trivially_copyable<T>::value){
+        while (n > 0){
+            if (next_free_index == tail_size) allocate_new_block();
+            const size_type room = tail_size - next_free_index;
+            const size_type k = n < room ? n : room;
+            std::memcpy(blocks[num_blocks - 1].data + next_free_index, data, k * sizeof(T));
+            next_free_index += k;
+            num_elements += k;
+            data += k;
+            n -= k;
+        }
+    } else {
+        append_n(data, n);
+    }
+}
+
+/*
+ * appends n elements and returns the segments holding them, ready to be
+ * written. Trivially default constructible T is left uninitialized like
+ * new T[n] would, anything else is value initialized. Under single_writer
+ * the new count is visible to readers before the caller writes, so the
+ * elements are always value initialized there.
+ */
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::template segment_range<false> vector<T, Allocator, Policy>::grow_by(size_type n) {
+    const size_type first = num_elements;
+    while (n > 0){
+        if (next_free_index == tail_size) allocate_new_block();
+        const size_type room = tail_size - next_free_index;
+        const size_type k = n < room ? n : room;
+        if constexpr (!std::is_trivially_default_constructible<T>::value || Policy::concurrent_reads){
+            T * dst = blocks[num_blocks - 1].data + next_free_index;
+            size_type i = 0;
+            try {
+                for (; i < k; ++i) alloc_traits::construct(alloc, dst + i);
+            } catch (...) {
+                while (i > 0) alloc_traits::destroy(alloc, dst + --i);
+                drop_empty_tail();
+                throw;
+            }
+        }
+        next_free_index += k;
+        num_elements += k;
+        n -= k;
+    }
+    return segment_range<false>(this, first, num_elements);
+}
+
+/*
+ * a tail block that runs empty is kept as a spare, so a size that goes
+ * back and forth across a block boundary does not free and allocate the
+ * same block every time. Only one spare is kept, anything past it is
+ * freed, reserved blocks included. Not for use while single_writer
+ * readers run, they could still be reading the element
+ */
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::pop_back() {
+    if (size_type(num_elements) == 0) throw std::out_of_range("no elements in jrd::vector");
+    // a copy may still see the element
+    if (__builtin_expect(num_shared != 0, 0) && shares[num_blocks - 1] != nullptr) unshare(num_blocks - 1);
+    block_type &blk = blocks[num_blocks - 1];
+    --next_free_index;
+    --num_elements;
+    alloc_traits::destroy(alloc, blk.data + next_free_index);
+    if (next_free_index == 0){
+        // every block before the tail is full
+        --num_blocks;
+        tail_size = num_blocks == 0 ? 0 : block_size(num_blocks - 1);
+        next_free_index = tail_size;
+        trim_blocks(num_blocks + 1);
+    }
 }
 
-template <typename T>
-void vector<T>::clear() noexcept {
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::swap(vector<T, Allocator, Policy> &rhs) {
     // TODO 
-    blocks.clear();
+}
+
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::clear() noexcept {
+    for (size_type b = 0; b < num_allocated; ++b){
+        release_block(b, b < num_blocks ? segment_length(b) : 0);
+    }
+    num_blocks = 0;
+    num_allocated = 0;
+    tail_size = 0;
     next_free_index = 0;
     num_elements = 0;
 }
 
-template <typename T>
-void vector<T>::allocate_new_block(){
-    if (blocks.size() == 1){
-        blocks.emplace_back(initial_size);
-    }else{
-        blocks.emplace_back(blocks.back().size * growth_factor);
+/*
+ * the snapshot keeps the contents as they are now while this vector goes
+ * on appending and writing, and may be read from another thread. Take it
+ * from the thread that writes this vector, it marks the shared blocks here
+ */
+template <typename T, typename Allocator, typename Policy>
+vector<T, Allocator, Policy> vector<T, Allocator, Policy>::snapshot() const {
+    return vector(*this);
+}
+
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::allocator_type vector<T, Allocator, Policy>::get_allocator() const noexcept {
+    return alloc;
+}
+
+template <typename T, typename Allocator, typename Policy>
+memory_stats vector<T, Allocator, Policy>::memory() const noexcept {
+    static_assert(Policy::track_memory, "jrd::vector::memory() needs a policy with track_memory, e.g. with_memory_stats<>");
+    const size_type bytes = footprint();
+    const size_type tail = num_blocks == 0 ? 0 : block_size(num_blocks - 1) - next_free_index;
+    memory_stats st = memory_stats();
+    st.bytes_allocated = bytes;
+    st.bytes_live = size_type(num_elements) * sizeof(T);
+    st.tail_slack = tail * sizeof(T);
+    st.spare_bytes = (block_start(num_allocated) - block_start(num_blocks)) * sizeof(T);
+    st.num_blocks = num_blocks;
+    st.num_allocated = num_allocated;
+    st.allocations = counters.allocations;
+    st.deallocations = counters.deallocations;
+    // blocks taken over from a copy raise the footprint without an allocation
+    st.peak_bytes = counters.peak_bytes > bytes ? counters.peak_bytes : bytes;
+    return st;
+}
+
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::allocate_new_block(){
+    if (num_blocks > 0 && tail_size != block_size(num_blocks - 1)){
+        // the tail of a copy, cut short so the first append lands here
+        if (shares[num_blocks - 1] != nullptr) unshare(num_blocks - 1);
+        tail_size = block_size(num_blocks - 1);
+        return;
     }
+    const size_type sz = block_size(num_blocks);
+    if (num_blocks == num_allocated){
+        blocks.ensure(num_blocks + 1, alloc);
+        blocks[num_blocks] = provision_block(num_blocks);
+        ++num_allocated;
+    }
+    ++num_blocks;
+    tail_size = sz;
     next_free_index = 0;
 }
 
+/*
+ * undoes allocate_new_block() when nothing could be built in the block it
+ * opened, every block up to num_blocks must hold at least one element.
+ * The block stays allocated past the tail as the spare
+ */
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::drop_empty_tail() noexcept {
+    if (num_blocks == 0 || next_free_index != 0) return;
+    --num_blocks;
+    tail_size = num_blocks == 0 ? 0 : block_size(num_blocks - 1);
+    next_free_index = tail_size;
+}
+
+/*
+ *
+ * index decomposition, all of it comes from the growth policy
+ *
+ */
+
+template <typename T, typename Allocator, typename Policy>
+inline typename vector<T, Allocator, Policy>::location_type vector<T, Allocator, Policy>::locate(size_type idx) noexcept {
+    return Policy::locate(idx);
+}
+
+template <typename T, typename Allocator, typename Policy>
+constexpr typename vector<T, Allocator, Policy>::size_type vector<T, Allocator, Policy>::block_start(size_type block) noexcept {
+    return Policy::block_start(block);
+}
+
+template <typename T, typename Allocator, typename Policy>
+constexpr typename vector<T, Allocator, Policy>::size_type vector<T, Allocator, Policy>::block_size(size_type block) noexcept {
+    return Policy::block_size(block);
+}
+
+// anything at or past num_elements is end(), which sits one past the last
+// element of the tail block even when the tail block is full
+template <typename T, typename Allocator, typename Policy>
+inline typename vector<T, Allocator, Policy>::iterator vector<T, Allocator, Policy>::make_iterator(size_type idx) const noexcept {
+    if (num_blocks == 0) return iterator(this, 0, empty_slot(), empty_slot());
+    if (idx >= num_elements) {
+        const block_type & tail = blocks[num_blocks - 1];
+        return iterator(this, num_blocks - 1, tail.data + next_free_index, tail.data + tail_size);
+    }
+    const location_type loc = locate(idx);
+    const block_type & blk = blocks[loc.block];
+    return iterator(this, loc.block, blk.data + loc.offset, blk.data + block_size(loc.block));
+}
+
+/*
+ * where the iterators of an empty vector point, so cur is never null and
+ * begin() == end() still holds. Never dereferenced
+ */
+template <typename T, typename Allocator, typename Policy>
+inline T * vector<T, Allocator, Policy>::empty_slot() noexcept {
+    alignas(T) static unsigned char slot[sizeof(T)];
+    return reinterpret_cast<T *>(slot);
+}
+
+template <typename T, typename Allocator, typename Policy>
+inline typename vector<T, Allocator, Policy>::size_type vector<T, Allocator, Policy>::num_segments() const noexcept {
+    return num_elements == 0 ? 0 : num_blocks;
+}
+
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::gather(const size_type * indices, size_type n, T * out) const {
+    prefetched_walk<false>(indices, n, [out](size_type k, const T * p){ out[k] = *p; });
+}
+
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::scatter(const size_type * indices, size_type n, const T * values) {
+    detach();
+    prefetched_walk<true>(indices, n, [values](size_type k, T * p){ *p = values[k]; });
+}
+
+/*
+ * a lone random [] loads the directory slot and then the element, and
+ * the element load cannot start before locate() is done. Here indices
+ * are decoded prefetch_distance ahead of the access into a small ring of
+ * addresses, each prefetched as it is decoded, so that many element
+ * loads are in flight by the time visit() reaches them. Indices are not
+ * regrouped by block: the directory is a few cache lines that stay hot,
+ * what costs is the element miss, which grouping does not save.
+ */
+template <typename T, typename Allocator, typename Policy>
+template <bool for_write, class Visit>
+void vector<T, Allocator, Policy>::prefetched_walk(const size_type * indices, size_type n, Visit visit) const {
+    T * ahead[prefetch_distance];
+    const size_type lead = n < prefetch_distance ? n : prefetch_distance;
+    for (size_type k = 0; k < lead; ++k){
+        const location_type loc = locate(indices[k]);
+        ahead[k] = blocks[loc.block].data + loc.offset;
+        __builtin_prefetch(ahead[k], for_write ? 1 : 0);
+    }
+    for (size_type k = 0; k < n; ++k){
+        T * p = ahead[k % prefetch_distance];
+        if (k + prefetch_distance < n){
+            const location_type loc = locate(indices[k + prefetch_distance]);
+            T * next = blocks[loc.block].data + loc.offset;
+            __builtin_prefetch(next, for_write ? 1 : 0);
+            ahead[k % prefetch_distance] = next;
+        }
+        visit(k, p);
+    }
+}
+
+// every block before the tail is full, the tail holds next_free_index
+template <typename T, typename Allocator, typename Policy>
+inline typename vector<T, Allocator, Policy>::size_type vector<T, Allocator, Policy>::segment_length(size_type block) const noexcept {
+    return block + 1 == num_blocks ? next_free_index : block_size(block);
+}
+
+template <typename T, typename Allocator, typename Policy>
+inline typename vector<T, Allocator, Policy>::reference vector<T, Allocator, Policy>::unchecked_at(size_type idx) {
+    const location_type loc = locate(idx);
+    // num_shared first, a vector that was never copied does not look at
+    // shares. It does not change inside a read loop, so the compiler
+    // hoists the test and the loop runs the same code as the const one
+    if (__builtin_expect(num_shared != 0, 0) && shares[loc.block] != nullptr) unshare(loc.block);
+    return blocks[loc.block].data[loc.offset];
+}
+
+template <typename T, typename Allocator, typename Policy>
+inline typename vector<T, Allocator, Policy>::const_reference vector<T, Allocator, Policy>::unchecked_at(size_type idx) const noexcept {
+    const location_type loc = locate(idx);
+    return blocks[loc.block].data[loc.offset];
+}
+
+// copy constructs n elements from first, one block at a time. If a
+// constructor throws, the elements of that block are undone, a block
+// left empty goes back to being the spare, and the earlier blocks stay
+// appended
+template <typename T, typename Allocator, typename Policy>
+template <class ForwardIt>
+void vector<T, Allocator, Policy>::append_n(ForwardIt first, size_type n) {
+    while (n > 0){
+        if (next_free_index == tail_size) allocate_new_block();
+        const size_type room = tail_size - next_free_index;
+        const size_type k = n < room ? n : room;
+        T * dst = blocks[num_blocks - 1].data + next_free_index;
+        size_type i = 0;
+        try {
+            for (; i < k; ++i, ++first) alloc_traits::construct(alloc, dst + i, *first);
+        } catch (...) {
+            while (i > 0) alloc_traits::destroy(alloc, dst + --i);
+            drop_empty_tail();
+            throw;
+        }
+        next_free_index += k;
+        num_elements += k;
+        n -= k;
+    }
+}
+
 /* 
  *
  * vector boolean operators
  * 
  */
 
-template <typename T>
-bool vector<T>::operator == (const vector<T> &rhs) const {
+// same size means same block layout, a block shared by both is skipped
+template <typename T, typename Allocator, typename Policy>
+bool vector<T, Allocator, Policy>::operator == (const vector<T, Allocator, Policy> &rhs) const {
+    if (num_elements != rhs.num_elements) return false;
+    const size_type n = num_segments();
+    for (size_type b = 0; b < n; ++b){
+        const T * lhs_data = blocks[b].data;
+        const T * rhs_data = rhs.blocks[b].data;
+        if (lhs_data != rhs_data && !std::equal(lhs_data, lhs_data + segment_length(b), rhs_data)) return false;
+    }
     return true;
 }
 
-template <typename T>
-bool vector<T>::operator != (const vector<T> &rhs) const {
-    return false;
+template <typename T, typename Allocator, typename Policy>
+bool vector<T, Allocator, Policy>::operator != (const vector<T, Allocator, Policy> &rhs) const {
+    return !(*this == rhs);
 }
 
 
-/* 
- * 
- * block_type member functions
- * 
+/*
+ *
+ * block allocation
+ *
  */
 
-template <typename T>
-vector<T>::block_type::~block_type(){
-    if (data != nullptr) delete[] data;
+// block 0 comes from inside the object when the policy keeps it inline
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::block_type vector<T, Allocator, Policy>::provision_block(size_type b) {
+    if constexpr (Policy::inline_first){
+        if (b == 0) return block_type{first_block.data()};
+    }
+    return allocate_block(block_size(b));
+}
+
+// raw storage, slots are constructed one at a time as elements are appended
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::block_type vector<T, Allocator, Policy>::allocate_block(size_type sz) {
+    return block_type{allocate_storage(sz)};
+}
+
+template <typename T, typename Allocator, typename Policy>
+inline T * vector<T, Allocator, Policy>::allocate_storage(size_type sz) {
+    T * data = alloc_traits::allocate(alloc, sz);
+    if constexpr (Policy::track_memory){
+        // the new block is not in the directory yet
+        const size_type now = footprint() + sz * sizeof(T);
+        ++counters.allocations;
+        if (now > counters.peak_bytes) counters.peak_bytes = now;
+    }
+    return data;
 }
 
-template <typename T>
-vector<T>::block_type::block_type() noexcept : data(nullptr), size(0) {}
+template <typename T, typename Allocator, typename Policy>
+inline void vector<T, Allocator, Policy>::deallocate_storage(T * data, size_type sz) noexcept {
+    alloc_traits::deallocate(alloc, data, sz);
+    if constexpr (Policy::track_memory) ++counters.deallocations;
+}
 
-template <typename T>
-vector<T>::block_type::block_type(const size_type in_size) : data(new T[in_size]), size(in_size){}
+// heap bytes held, the allocated blocks are a prefix of the chain
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::size_type vector<T, Allocator, Policy>::footprint() const noexcept {
+    size_type elems = block_start(num_allocated);
+    if (Policy::inline_first && num_allocated > 0) elems -= block_size(0);
+    return elems * sizeof(T) + blocks.heap_bytes();
+}
 
-template <typename T>
-vector<T>::block_type::block_type(const T * in_data, const size_type in_size) noexcept : data(in_data), size(in_size) {}
+// frees the empty blocks from the back until keep are left allocated
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::trim_blocks(size_type keep) noexcept {
+    while (num_allocated > keep){
+        --num_allocated;
+        release_block(num_allocated, 0);
+    }
+}
 
-template <typename T>
-vector<T>::block_type::block_type(vector<T>::block_type && other) noexcept : data(other.data), size(other.size) {
-    other.data = nullptr;
-    other.size = 0;
+// only the first live slots hold constructed elements
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::release_block(size_type b, size_type live) noexcept {
+    block_type &blk = blocks[b];
+    if (blk.data == nullptr) return;
+    if (shares[b] != nullptr){
+        release_shared(blk, b, live);
+        blk = block_type();
+        return;
+    }
+    if (!std::is_trivially_destructible<T>::value){
+        for (size_type i = 0; i < live; ++i) alloc_traits::destroy(alloc, blk.data + i);
+    }
+    if (!first_block.holds(blk.data)) deallocate_storage(blk.data, block_size(b));
+    blk = block_type();
 }
 
-template <typename T>
-typename vector<T>::block_type & vector<T>::block_type::operator=(block_type && other) noexcept {
-    if (this != &other) {
-        data = other.data;
-        size = other.size;
-        other.data = nullptr;
-        other.size = 0;
-    } 
-    return *this;
+
+
+/*
+ *
+ * block sharing between copies
+ *
+ * Appends never write to an element that already exists, so a block can
+ * be shared as soon as it holds anything. The source keeps appending into
+ * a shared tail past what the copies see, a copy gets its tail cut short
+ * and clones it before its first append. The counts are atomic so a copy
+ * can be read, and dropped, on another thread while the source writes.
+ *
+ */
+
+// hands block b to a copy, the count starts at two the first time
+template <typename T, typename Allocator, typename Policy>
+typename vector<T, Allocator, Policy>::block_share * vector<T, Allocator, Policy>::share_block(size_type b) const {
+    const size_type len = segment_length(b);
+    shares.ensure(b + 1, alloc);
+    block_share * &s = shares.slots[b];
+    if (s == nullptr){
+        share_allocator share_alloc(alloc);
+        s = std::allocator_traits<share_allocator>::allocate(share_alloc, 1);
+        ::new (static_cast<void *>(s)) block_share{{2}, {len}};
+        ++num_shared;
+    } else {
+        s->refs.fetch_add(1, std::memory_order_relaxed);
+        if (s->shared_len.load(std::memory_order_relaxed) < len) s->shared_len.store(len, std::memory_order_relaxed);
+    }
+    return s;
+}
+
+// called before block b is written. When every other holder has already
+// let go the block is just taken back, otherwise it is cloned
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::unshare(size_type b) {
+    block_type &blk = blocks[b];
+    block_share * &s = shares.slots[b];
+    const size_type live = segment_length(b);
+    if (s->refs.load(std::memory_order_acquire) == 1){
+        // what the source appended past our end is still constructed
+        const size_type seen = s->shared_len.load(std::memory_order_relaxed);
+        if (!std::is_trivially_destructible<T>::value){
+            for (size_type i = live; i < seen; ++i) alloc_traits::destroy(alloc, blk.data + i);
+        }
+        share_allocator share_alloc(alloc);
+        std::allocator_traits<share_allocator>::deallocate(share_alloc, s, 1);
+        s = nullptr;
+        --num_shared;
+        return;
+    }
+    const size_type sz = block_size(b);
+    T * fresh = allocate_storage(sz);
+    if constexpr (std::is_trivially_copyable<T>::value){
+        std::memcpy(fresh, blk.data, live * sizeof(T));
+    } else {
+        size_type i = 0;
+        try {
+            for (; i < live; ++i) alloc_traits::construct(alloc, fresh + i, blk.data[i]);
+        } catch (...) {
+            while (i > 0) alloc_traits::destroy(alloc, fresh + --i);
+            deallocate_storage(fresh, sz);
+            throw;
+        }
+    }
+    release_shared(blk, b, live);
+    blk = block_type{fresh};
+}
+
+/*
+ * drops this vector's hold on a shared block. Elements past shared_len
+ * were appended by this vector alone and go first, while the block is
+ * surely still alive, the last holder then frees the rest
+ */
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::release_shared(block_type &blk, size_type b, size_type live) noexcept {
+    block_share * &s = shares.slots[b];
+    const size_type seen = s->shared_len.load(std::memory_order_relaxed);
+    if (!std::is_trivially_destructible<T>::value){
+        for (size_type i = seen; i < live; ++i) alloc_traits::destroy(alloc, blk.data + i);
+    }
+    if (s->refs.fetch_sub(1, std::memory_order_acq_rel) == 1){
+        if (!std::is_trivially_destructible<T>::value){
+            for (size_type i = 0; i < seen; ++i) alloc_traits::destroy(alloc, blk.data + i);
+        }
+        deallocate_storage(blk.data, block_size(b));
+        share_allocator share_alloc(alloc);
+        std::allocator_traits<share_allocator>::deallocate(share_alloc, s, 1);
+    }
+    s = nullptr;
+    --num_shared;
+}
+
+// every block becomes private, done before handing out mutable iterators
+template <typename T, typename Allocator, typename Policy>
+inline void vector<T, Allocator, Policy>::detach() {
+    if (__builtin_expect(num_shared != 0, 0)) unshare_all();
+}
+
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::unshare_all() {
+    for (size_type b = 0; b < num_blocks; ++b){
+        if (shares[b] != nullptr) unshare(b);
+    }
+}
+
+// this is empty. Blocks are shared when both vectors allocate from the
+// same place, the inline first block is always copied. The tail is cut
+// short at its last element, see allocate_new_block()
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::copy_from(const vector<T, Allocator, Policy> &other) {
+    const bool can_share = alloc == other.alloc;
+    const size_type n = other.num_segments();
+    for (size_type b = 0; b < n; ++b){
+        const T * data = other.blocks[b].data;
+        const size_type len = other.segment_length(b);
+        if (can_share && !other.first_block.holds(data)){
+            blocks.ensure(b + 1, alloc);
+            shares.ensure(b + 1, alloc);
+            shares.slots[b] = other.share_block(b);
+            blocks[b] = other.blocks[b];
+            ++num_shared;
+            num_blocks = b + 1;
+            num_allocated = b + 1;
+            tail_size = len;
+            next_free_index = len;
+            num_elements += len;
+        } else {
+            append(data, len);
+        }
+    }
+}
+
+// takes every block of other, which is left empty. The allocators compare
+// equal. Only an inline first block stays behind, its elements are moved
+template <typename T, typename Allocator, typename Policy>
+void vector<T, Allocator, Policy>::steal(vector<T, Allocator, Policy> &other) noexcept {
+    blocks.take(other.blocks, other.num_allocated, alloc);
+    shares.take(other.shares, alloc);
+    num_elements = other.num_elements;
+    next_free_index = other.next_free_index;
+    num_blocks = other.num_blocks;
+    num_allocated = other.num_allocated;
+    tail_size = other.tail_size;
+    num_shared = other.num_shared;
+    counters = other.counters;
+    if constexpr (Policy::inline_first){
+        if (num_allocated > 0){
+            const size_type live = num_blocks > 0 ? segment_length(0) : 0;
+            T * src = other.first_block.data();
+            T * dst = first_block.data();
+            for (size_type i = 0; i < live; ++i){
+                alloc_traits::construct(alloc, dst + i, std::move(src[i]));
+                alloc_traits::destroy(other.alloc, src + i);
+            }
+            blocks[0].data = dst;
+        }
+    }
+    other.num_elements = 0;
+    other.next_free_index = 0;
+    other.num_blocks = 0;
+    other.num_allocated = 0;
+    other.tail_size = 0;
+    other.num_shared = 0;
+    other.counters = memory_counters<Policy::track_memory>();
 }
 
 
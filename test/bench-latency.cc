@@ -0,0 +1,109 @@
+#include "vector.h"
+#include "bench.h"
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iostream>
+
+
+/*
+ * Latency of every single push_back, for std::vector, std::deque and
+ * jrd::vector. The mean hides a reallocating std::vector copying the
+ * whole array once every doubling, the p99.9 and the max show it.
+ *
+ * The clock is read once per batch of appends, the default batch is one.
+ * A clock case with no append in between gives the floor the other
+ * figures sit on.
+ *
+ *     ./bench-latency [out.json] [max size] [batch]
+ */
+
+
+struct latency_case {
+    std::string container;
+    std::string type;
+    size_t size;
+    jrd::bench::latency_histogram hist;
+};
+
+template <class C, class Make>
+void append_latency(size_t n, size_t batch, jrd::bench::latency_histogram &hist, Make make) {
+    C c;
+    double prev = jrd::bench::now_ns();
+    for (size_t i = 0; i < n; i += batch){
+        const size_t end = std::min(n, i + batch);
+        for (size_t j = i; j < end; ++j) c.push_back(make(j));
+        const double now = jrd::bench::now_ns();
+        hist.record(static_cast<uint64_t>(now - prev));
+        prev = now;
+    }
+    jrd::bench::do_not_optimize(c);
+}
+
+static void print_case(const latency_case &lc) {
+    const jrd::bench::latency_histogram &h = lc.hist;
+    std::cout << std::left << std::setw(14) << lc.container << std::setw(10) << lc.type << std::right << std::setw(11) << lc.size
+              << std::setw(9) << h.percentile(0.5) << std::setw(9) << h.percentile(0.99) << std::setw(9) << h.percentile(0.999)
+              << std::setw(14) << h.max() << std::setw(10) << std::fixed << std::setprecision(2) << h.mean() << std::endl;
+}
+
+template <typename T, class Make>
+void run_type(std::deque<latency_case> &out, const char * type, size_t n, size_t batch, Make make) {
+    const char * names[3] = {"std::vector", "std::deque", "jrd::vector"};
+    for (size_t k = 0; k < 3; ++k){
+        out.push_back(latency_case{names[k], type, n, jrd::bench::latency_histogram()});
+        latency_case &lc = out.back();
+        if (k == 0) append_latency<std::vector<T>>(n, batch, lc.hist, make);
+        else if (k == 1) append_latency<std::deque<T>>(n, batch, lc.hist, make);
+        else append_latency<jrd::vector<T>>(n, batch, lc.hist, make);
+        print_case(lc);
+    }
+}
+
+int main(int argc, char ** argv){
+    const std::string path = argc > 1 ? argv[1] : "bench-latency.json";
+    const size_t max_size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000000;
+    const size_t batch = argc > 3 && std::strtoull(argv[3], nullptr, 10) > 0 ? std::strtoull(argv[3], nullptr, 10) : 1;
+    // long enough that every copy allocates
+    const std::string proto(40, 'x');
+
+    std::cout << "ns per batch of " << batch << " push_back" << std::endl;
+    std::cout << std::left << std::setw(14) << "container" << std::setw(10) << "type" << std::right << std::setw(11) << "size"
+              << std::setw(9) << "p50" << std::setw(9) << "p99" << std::setw(9) << "p99.9" << std::setw(14) << "max" << std::setw(10) << "mean" << std::endl;
+
+    std::deque<latency_case> cases;
+    for (size_t n = 1000000; n <= max_size; n *= 10){
+        // the floor, two clock reads and a histogram update
+        cases.push_back(latency_case{"clock", "-", n, jrd::bench::latency_histogram()});
+        latency_case &floor = cases.back();
+        double prev = jrd::bench::now_ns();
+        for (size_t i = 0; i < n; i += batch){
+            const double now = jrd::bench::now_ns();
+            floor.hist.record(static_cast<uint64_t>(now - prev));
+            prev = now;
+        }
+        print_case(floor);
+
+        run_type<uint64_t>(cases, "uint64_t", n, batch, [](size_t i) -> uint64_t { return i; });
+        // 100M strings would not fit next to their copies
+        if (n <= 10000000) run_type<std::string>(cases, "string", n, batch, [&](size_t){ return proto; });
+    }
+
+    std::ofstream json(path);
+    json << "{\n  \"unit\": \"ns\",\n  \"batch\": " << batch << ",\n  \"results\": [";
+    for (size_t i = 0; i < cases.size(); ++i){
+        const latency_case &lc = cases[i];
+        json << (i == 0 ? "\n" : ",\n")
+             << "    {\"container\": \"" << lc.container << "\", \"type\": \"" << lc.type << "\", \"size\": " << lc.size
+             << ", \"count\": " << lc.hist.count() << ", \"mean\": " << lc.hist.mean()
+             << ", \"p50\": " << lc.hist.percentile(0.5) << ", \"p99\": " << lc.hist.percentile(0.99)
+             << ", \"p999\": " << lc.hist.percentile(0.999) << ", \"max\": " << lc.hist.max() << ", \"histogram\": ";
+        lc.hist.write_json(json);
+        json << "}";
+    }
+    json << "\n  ]\n}\n";
+    std::cout << "wrote " << cases.size() << " results to " << path << std::endl;
+}
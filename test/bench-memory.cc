@@ -0,0 +1,137 @@
+#include "vector.h"
+#include "bench.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/*
+ * Peak resident memory of filling std::vector, std::deque and jrd::vector
+ * with n elements by push_back, as bytes per element. The peak RSS of a
+ * process never comes down, so every case runs in a forked child and only
+ * the growth over the child's starting peak is counted. jrd::vector runs
+ * with with_memory_stats so its own accounting is printed next to it.
+ *
+ *     ./bench-memory [out.json]
+ */
+
+
+struct memory_case {
+    char container[16];
+    size_t size;
+    size_t peak_rss;        // bytes the peak grew by while filling
+    bool has_stats;
+    jrd::memory_stats stats;
+};
+
+static size_t peak_rss_bytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // kilobytes on Linux
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+template <class C>
+void record_stats(const C &, memory_case &) {}
+
+template <typename T, typename Allocator>
+void record_stats(const jrd::vector<T, Allocator, jrd::with_memory_stats<>> &c, memory_case &mc) {
+    mc.has_stats = true;
+    mc.stats = c.memory();
+}
+
+template <class C>
+void fill(memory_case &mc) {
+    const size_t before = peak_rss_bytes();
+    C c;
+    for (size_t i = 0; i < mc.size; ++i) c.push_back(static_cast<typename C::value_type>(i));
+    jrd::bench::do_not_optimize(c);
+    mc.peak_rss = peak_rss_bytes() - before;
+    record_stats(c, mc);
+}
+
+// runs fill() in a child and reads the case back through a pipe
+template <class C>
+memory_case run_case(const char * name, size_t n) {
+    memory_case mc = memory_case();
+    std::snprintf(mc.container, sizeof(mc.container), "%s", name);
+    mc.size = n;
+    int fds[2];
+    if (pipe(fds) != 0) throw std::runtime_error("bench-memory: pipe failed");
+    const pid_t pid = fork();
+    if (pid < 0) throw std::runtime_error("bench-memory: fork failed");
+    if (pid == 0){
+        close(fds[0]);
+        fill<C>(mc);
+        const ssize_t w = write(fds[1], &mc, sizeof(mc));
+        _exit(w == static_cast<ssize_t>(sizeof(mc)) ? 0 : 1);
+    }
+    close(fds[1]);
+    const ssize_t r = read(fds[0], &mc, sizeof(mc));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (r != static_cast<ssize_t>(sizeof(mc)) || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+        throw std::runtime_error("bench-memory: child for " + std::string(name) + " failed");
+    }
+    return mc;
+}
+
+static void print_case(const memory_case &mc) {
+    const double per = static_cast<double>(mc.peak_rss) / static_cast<double>(mc.size);
+    std::cout << std::left << std::setw(14) << mc.container << std::right << std::setw(11) << mc.size
+              << std::setw(14) << mc.peak_rss / 1024 << std::setw(10) << std::fixed << std::setprecision(2) << per;
+    if (mc.has_stats){
+        const jrd::memory_stats &st = mc.stats;
+        std::cout << "   allocated " << st.bytes_allocated / 1024 << " KiB, live " << st.bytes_live / 1024
+                  << " KiB, tail slack " << st.tail_slack / 1024 << " KiB, " << st.num_blocks << " blocks, "
+                  << st.allocations << " allocations";
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char ** argv){
+    typedef jrd::vector<uint64_t, std::allocator<uint64_t>, jrd::with_memory_stats<>> tracked_vector;
+    const std::string path = argc > 1 ? argv[1] : "bench-memory.json";
+
+    std::cout << "uint64_t by push_back" << std::endl;
+    std::cout << std::left << std::setw(14) << "container" << std::right << std::setw(11) << "size"
+              << std::setw(14) << "peak KiB" << std::setw(10) << "B/elem" << std::endl;
+
+    std::vector<memory_case> cases;
+    // 2^24 + 1 is one past a block boundary, the worst case for the tail
+    for (size_t n : {size_t(1000000), (size_t(1) << 24) + 1, size_t(100000000)}){
+        cases.push_back(run_case<std::vector<uint64_t>>("std::vector", n));
+        print_case(cases.back());
+        cases.push_back(run_case<std::deque<uint64_t>>("std::deque", n));
+        print_case(cases.back());
+        cases.push_back(run_case<tracked_vector>("jrd::vector", n));
+        print_case(cases.back());
+    }
+
+    std::ofstream json(path);
+    json << "{\n  \"type\": \"uint64_t\",\n  \"results\": [";
+    for (size_t i = 0; i < cases.size(); ++i){
+        const memory_case &mc = cases[i];
+        json << (i == 0 ? "\n" : ",\n")
+             << "    {\"container\": \"" << mc.container << "\", \"size\": " << mc.size << ", \"peak_rss\": " << mc.peak_rss
+             << ", \"bytes_per_element\": " << static_cast<double>(mc.peak_rss) / static_cast<double>(mc.size);
+        if (mc.has_stats){
+            const jrd::memory_stats &st = mc.stats;
+            json << ", \"bytes_allocated\": " << st.bytes_allocated << ", \"bytes_live\": " << st.bytes_live
+                 << ", \"tail_slack\": " << st.tail_slack << ", \"num_blocks\": " << st.num_blocks
+                 << ", \"allocations\": " << st.allocations << ", \"peak_bytes\": " << st.peak_bytes;
+        }
+        json << "}";
+    }
+    json << "\n  ]\n}\n";
+    std::cout << "wrote " << cases.size() << " results to " << path << std::endl;
+}
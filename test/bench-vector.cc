@@ -0,0 +1,114 @@
+#include "vector.h"
+#include "bench.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <iostream>
+
+
+/*
+ * std::vector, std::deque and jrd::vector side by side over a few element
+ * types and sizes. Every container reads the same values in the same
+ * order, the random reads follow one index stream drawn up front.
+ *
+ *     ./bench-vector [out.json]
+ */
+
+
+struct record64 {
+    uint64_t key;
+    uint64_t pad[7];
+};
+
+template <typename T> struct type_name;
+template <> struct type_name<uint32_t> { static const char * get() { return "uint32_t"; } };
+template <> struct type_name<uint64_t> { static const char * get() { return "uint64_t"; } };
+template <> struct type_name<record64> { static const char * get() { return "record64"; } };
+template <> struct type_name<std::string> { static const char * get() { return "string"; } };
+
+template <class C> struct container_name;
+template <typename T> struct container_name<std::vector<T>> { static const char * get() { return "std::vector"; } };
+template <typename T> struct container_name<std::deque<T>> { static const char * get() { return "std::deque"; } };
+template <typename T> struct container_name<jrd::vector<T>> { static const char * get() { return "jrd::vector"; } };
+
+template <typename T> T make_value(size_t i);
+template <> uint32_t make_value<uint32_t>(size_t i) { return static_cast<uint32_t>(i); }
+template <> uint64_t make_value<uint64_t>(size_t i) { return i; }
+template <> record64 make_value<record64>(size_t i) { return record64{i, {}}; }
+// long enough to miss the small string buffer
+template <> std::string make_value<std::string>(size_t i) { return "a string past the sso buffer " + std::to_string(i); }
+
+inline size_t weight(uint32_t v) { return v; }
+inline size_t weight(uint64_t v) { return v; }
+inline size_t weight(const record64 &v) { return v.key; }
+inline size_t weight(const std::string &v) { return v.size(); }
+
+
+template <class C>
+void run_container(jrd::bench::report &rep, const jrd::bench::options &opt, const std::vector<typename C::value_type> &values, const std::vector<size_t> &idx) {
+    typedef typename C::value_type T;
+    const size_t n = values.size();
+    auto add = [&](const char * name, const jrd::bench::stats &s){
+        rep.add(jrd::bench::result{name, container_name<C>::get(), type_name<T>::get(), n, s});
+    };
+
+    add("push_back", jrd::bench::measure_fresh(opt, n, []{ return C(); }, [&](C &c){
+        for (const T &v : values) c.push_back(v);
+    }));
+
+    C c;
+    for (const T &v : values) c.push_back(v);
+    const C &cc = c;
+
+    add("index_seq", jrd::bench::measure(opt, n, [&]{
+        size_t sum = 0;
+        for (size_t i = 0; i < n; ++i) sum += weight(cc[i]);
+        jrd::bench::do_not_optimize(sum);
+    }));
+
+    add("iterate", jrd::bench::measure(opt, n, [&]{
+        size_t sum = 0;
+        for (const T &v : cc) sum += weight(v);
+        jrd::bench::do_not_optimize(sum);
+    }));
+
+    add("index_random", jrd::bench::measure(opt, idx.size(), [&]{
+        size_t sum = 0;
+        for (size_t i : idx) sum += weight(cc[i]);
+        jrd::bench::do_not_optimize(sum);
+    }));
+}
+
+template <typename T>
+void run_type(jrd::bench::report &rep, size_t n) {
+    // fewer samples for the large sizes so a full run stays within minutes
+    jrd::bench::options opt;
+    opt.samples = n <= (size_t(1) << 12) ? 201 : n <= (size_t(1) << 18) ? 51 : 15;
+    opt.warmup = n <= (size_t(1) << 18) ? 3 : 1;
+
+    std::vector<T> values;
+    values.reserve(n);
+    for (size_t i = 0; i < n; ++i) values.push_back(make_value<T>(i));
+    const std::vector<size_t> idx = jrd::bench::index_stream(n, n);
+
+    run_container<std::vector<T>>(rep, opt, values, idx);
+    run_container<std::deque<T>>(rep, opt, values, idx);
+    run_container<jrd::vector<T>>(rep, opt, values, idx);
+}
+
+int main(int argc, char ** argv){
+    const std::string out = argc > 1 ? argv[1] : "bench-vector.json";
+    jrd::bench::report rep;
+    jrd::bench::report::print_header(std::cout);
+
+    for (size_t n : {size_t(1) << 10, size_t(1) << 16, size_t(1) << 22}){
+        run_type<uint32_t>(rep, n);
+        run_type<uint64_t>(rep, n);
+        run_type<record64>(rep, n);
+        if (n <= (size_t(1) << 16)) run_type<std::string>(rep, n);
+    }
+
+    rep.write_json(out);
+    std::cout << "wrote " << rep.entries().size() << " results to " << out << std::endl;
+}
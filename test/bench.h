@@ -0,0 +1,304 @@
+#ifndef _JRD_BENCH_H
+#define _JRD_BENCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+/*
+ *
+ * Benchmark harness for the jrd containers
+ *
+ * measure() times one body many times and keeps every sample instead of a
+ * single average, so the report can give the median, the p99 and the
+ * spread. Warmup runs go first and are thrown away, they fault in the
+ * memory and train the branch predictors. Bodies that finish in less
+ * than min_sample_ns are repeated inside one sample until they don't,
+ * which keeps the clock overhead out of the numbers.
+ *
+ * Anything random, like an index stream, has to be built before the
+ * timed region with index_stream(), and every result has to go through
+ * do_not_optimize() or the compiler is free to delete the loop that made
+ * it.
+ *
+ * report collects the results, prints them as a table and writes them
+ * out as JSON for comparing runs.
+ *
+ * latency_histogram is for timing every operation on its own, where
+ * keeping each sample would cost more memory than the container under
+ * test. Values below 32ns are counted exactly, above that each power of
+ * two is split into 32 buckets, so a percentile is off by at most 3%.
+ *
+ */
+
+
+namespace jrd{
+namespace bench{
+
+struct options {
+    size_t warmup = 3;
+    size_t samples = 51;
+    double min_sample_ns = 20000.0;
+};
+
+// per operation figures in nanoseconds
+struct stats {
+    size_t samples;
+    double median;
+    double p99;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+};
+
+struct result {
+    std::string name;
+    std::string container;
+    std::string type;
+    size_t size;
+    stats ns_per_op;
+};
+
+
+// forces value to be computed and kept, without adding a load or store
+template <typename T>
+inline void do_not_optimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename T>
+inline void do_not_optimize(T &value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+// every store before it has to happen
+inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+
+inline double now_ns() noexcept {
+    typedef std::chrono::steady_clock clock;
+    return std::chrono::duration<double, std::nano>(clock::now().time_since_epoch()).count();
+}
+
+// count indices in [0, bound), the same seed gives the same stream to every container
+inline std::vector<size_t> index_stream(size_t count, size_t bound, uint64_t seed = 42) {
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<size_t> dist(0, bound == 0 ? 0 : bound - 1);
+    std::vector<size_t> idx(count);
+    for (auto &i : idx) i = dist(gen);
+    return idx;
+}
+
+inline stats summarize(std::vector<double> ns) {
+    if (ns.empty()) throw std::invalid_argument("jrd::bench::summarize needs at least one sample");
+    std::sort(ns.begin(), ns.end());
+    const size_t n = ns.size();
+    stats s = stats();
+    s.samples = n;
+    s.min = ns.front();
+    s.max = ns.back();
+    s.median = n % 2 ? ns[n / 2] : (ns[n / 2 - 1] + ns[n / 2]) / 2.0;
+    // nearest rank, with fewer than 100 samples this is the maximum
+    s.p99 = ns[static_cast<size_t>(std::ceil(0.99 * static_cast<double>(n))) - 1];
+    double sum = 0.0;
+    for (double v : ns) sum += v;
+    s.mean = sum / static_cast<double>(n);
+    double sq = 0.0;
+    for (double v : ns) sq += (v - s.mean) * (v - s.mean);
+    s.stddev = n > 1 ? std::sqrt(sq / static_cast<double>(n - 1)) : 0.0;
+    return s;
+}
+
+/*
+ * run() is timed against state it leaves as it found it, ops is how many
+ * operations one call performs. The first warmup call also works out how
+ * many calls make up one sample.
+ */
+template <class Run>
+stats measure(const options &opt, size_t ops, Run run) {
+    size_t reps = 1;
+    for (size_t w = 0; w < std::max<size_t>(opt.warmup, 1); ++w){
+        const double t0 = now_ns();
+        for (size_t r = 0; r < reps; ++r) run();
+        const double t1 = now_ns();
+        if (w == 0 && t1 - t0 < opt.min_sample_ns){
+            reps = static_cast<size_t>(opt.min_sample_ns / std::max(t1 - t0, 1.0)) + 1;
+        }
+    }
+    std::vector<double> ns;
+    ns.reserve(opt.samples);
+    for (size_t s = 0; s < opt.samples; ++s){
+        const double t0 = now_ns();
+        for (size_t r = 0; r < reps; ++r) run();
+        const double t1 = now_ns();
+        ns.push_back((t1 - t0) / static_cast<double>(reps * std::max<size_t>(ops, 1)));
+    }
+    return summarize(std::move(ns));
+}
+
+/*
+ * For bodies that consume their state, like filling an empty container.
+ * make() builds a fresh state before every call and it is destroyed
+ * after the clock stops, neither is timed.
+ */
+template <class Make, class Run>
+stats measure_fresh(const options &opt, size_t ops, Make make, Run run) {
+    for (size_t w = 0; w < opt.warmup; ++w){
+        auto state = make();
+        run(state);
+        do_not_optimize(state);
+    }
+    std::vector<double> ns;
+    ns.reserve(opt.samples);
+    for (size_t s = 0; s < opt.samples; ++s){
+        auto state = make();
+        clobber_memory();
+        const double t0 = now_ns();
+        run(state);
+        do_not_optimize(state);
+        const double t1 = now_ns();
+        ns.push_back((t1 - t0) / static_cast<double>(std::max<size_t>(ops, 1)));
+    }
+    return summarize(std::move(ns));
+}
+
+
+class latency_histogram {
+    public:
+        latency_histogram() : counts(), total(0), sum(0.0), largest(0) {}
+
+        void record(uint64_t ns) noexcept {
+            ++counts[bucket(ns)];
+            ++total;
+            sum += static_cast<double>(ns);
+            if (ns > largest) largest = ns;
+        }
+
+        uint64_t count() const noexcept { return total; }
+        uint64_t max() const noexcept { return largest; }
+        double mean() const noexcept { return total == 0 ? 0.0 : sum / static_cast<double>(total); }
+
+        // smallest bucket bound with at least p of the samples at or below it
+        uint64_t percentile(double p) const noexcept {
+            if (total == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(std::ceil(p * static_cast<double>(total)));
+            if (rank == 0) rank = 1;
+            uint64_t seen = 0;
+            for (size_t b = 0; b < num_buckets; ++b){
+                seen += counts[b];
+                if (seen >= rank) return std::min(upper(b), largest);
+            }
+            return largest;
+        }
+
+        // one row per power of two that holds any samples
+        void print(std::ostream &os) const {
+            for (size_t e = 0; e < num_buckets / sub; ++e){
+                uint64_t n = 0;
+                for (size_t b = e * sub; b < (e + 1) * sub; ++b) n += counts[b];
+                if (n == 0) continue;
+                const uint64_t lo = e == 0 ? 0 : uint64_t(sub) << (e - 1);
+                os << "    >= " << std::setw(12) << lo << " ns: " << std::setw(12) << n << std::endl;
+            }
+        }
+
+        // [upper bound, count] for every non empty bucket
+        void write_json(std::ostream &os) const {
+            os << "[";
+            bool first = true;
+            for (size_t b = 0; b < num_buckets; ++b){
+                if (counts[b] == 0) continue;
+                os << (first ? "" : ", ") << "[" << upper(b) << ", " << counts[b] << "]";
+                first = false;
+            }
+            os << "]";
+        }
+
+    private:
+        static constexpr size_t sub_bits = 5;
+        static constexpr size_t sub = size_t(1) << sub_bits;
+        static constexpr size_t num_buckets = (64 - sub_bits + 1) * sub;
+
+        static size_t bucket(uint64_t v) noexcept {
+            if (v < sub) return v;
+            const size_t e = static_cast<size_t>(63 - __builtin_clzll(v)) - sub_bits + 1;
+            return e * sub + (v >> (e - 1)) - sub;
+        }
+
+        static uint64_t upper(size_t b) noexcept {
+            const size_t e = b / sub;
+            if (e == 0) return b;
+            return ((b % sub + sub + 1) << (e - 1)) - 1;
+        }
+
+        uint64_t counts[num_buckets];
+        uint64_t total;
+        double sum;
+        uint64_t largest;
+};
+
+
+class report {
+    public:
+        report() : results() {}
+
+        void add(const result &r) {
+            results.push_back(r);
+            print(std::cout, r);
+        }
+
+        const std::vector<result> & entries() const noexcept { return results; }
+
+        static void print_header(std::ostream &os) {
+            os << std::left << std::setw(14) << "benchmark" << std::setw(14) << "container" << std::setw(14) << "type"
+               << std::right << std::setw(10) << "size" << std::setw(8) << "samples"
+               << std::setw(12) << "median" << std::setw(12) << "p99" << std::setw(12) << "stddev" << "  (ns/op)" << std::endl;
+        }
+
+        static void print(std::ostream &os, const result &r) {
+            const std::ios_base::fmtflags flags = os.flags();
+            os << std::left << std::setw(14) << r.name << std::setw(14) << r.container << std::setw(14) << r.type
+               << std::right << std::setw(10) << r.size << std::setw(8) << r.ns_per_op.samples
+               << std::fixed << std::setprecision(3)
+               << std::setw(12) << r.ns_per_op.median << std::setw(12) << r.ns_per_op.p99 << std::setw(12) << r.ns_per_op.stddev << std::endl;
+            os.flags(flags);
+        }
+
+        void write_json(const std::string &path) const {
+            std::ofstream out(path);
+            if (!out) throw std::runtime_error("jrd::bench cannot open " + path);
+            out << "{\n  \"clock\": \"steady_clock\",\n  \"unit\": \"ns/op\",\n  \"compiler\": \"" << __VERSION__ << "\",\n  \"results\": [";
+            out << std::setprecision(6);
+            for (size_t i = 0; i < results.size(); ++i){
+                const result &r = results[i];
+                const stats &s = r.ns_per_op;
+                out << (i == 0 ? "\n" : ",\n")
+                    << "    {\"name\": \"" << r.name << "\", \"container\": \"" << r.container << "\", \"type\": \"" << r.type
+                    << "\", \"size\": " << r.size << ", \"samples\": " << s.samples
+                    << ", \"median\": " << s.median << ", \"p99\": " << s.p99 << ", \"mean\": " << s.mean
+                    << ", \"stddev\": " << s.stddev << ", \"min\": " << s.min << ", \"max\": " << s.max << "}";
+            }
+            out << "\n  ]\n}\n";
+            if (!out) throw std::runtime_error("jrd::bench failed writing " + path);
+        }
+
+    private:
+        std::vector<result> results;
+};
+
+} // namespace bench
+} // namespace jrd
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef _JRD_PERF_COUNTERS_H
+#define _JRD_PERF_COUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+/*
+ *
+ * Hardware counters around a benchmark region through perf_event_open
+ *
+ * Every event is opened on its own rather than as a group, so a machine
+ * without, say, a dTLB event still reports the rest. Counts are user
+ * space only and are scaled up when the kernel had to multiplex the
+ * counters. start() and stop() accumulate, so a region timed over many
+ * iterations can be divided by the total number of operations at the
+ * end.
+ *
+ * When no event can be opened (not Linux, a container without the
+ * syscall, perf_event_paranoid too high) available() is false, error()
+ * says why and start() and stop() do nothing.
+ *
+ */
+
+
+namespace jrd{
+namespace bench{
+
+class perf_counters {
+    public:
+        enum event { cycles, instructions, cache_misses, dtlb_misses, branch_misses, num_events };
+
+        explicit perf_counters(bool enable = true);
+        ~perf_counters();
+        perf_counters(const perf_counters &) = delete;
+        perf_counters & operator = (const perf_counters &) = delete;
+
+        bool available() const noexcept { return num_open != 0; }
+        bool has(event e) const noexcept { return fds[e] >= 0; }
+        const std::string & error() const noexcept { return reason; }
+
+        void start() noexcept;
+        void stop() noexcept;
+        void reset() noexcept;
+
+        double total(event e) const noexcept { return totals[e]; }
+        static const char * name(event e) noexcept;
+
+    private:
+        int fds[num_events];
+        double totals[num_events];
+        size_t num_open;
+        std::string reason;
+};
+
+
+inline const char * perf_counters::name(event e) noexcept {
+    static const char * const names[num_events] = {"cycles", "instructions", "cache-misses", "dTLB-misses", "branch-misses"};
+    return names[e];
+}
+
+#ifdef __linux__
+
+namespace detail{
+
+inline int open_event(uint32_t type, uint64_t config) noexcept {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // namespace detail
+
+inline perf_counters::perf_counters(bool enable) : fds(), totals(), num_open(0), reason() {
+    for (int &fd : fds) fd = -1;
+    if (!enable){
+        reason = "disabled";
+        return;
+    }
+    const uint64_t dtlb_read_miss = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const uint32_t types[num_events] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+    const uint64_t configs[num_events] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, dtlb_read_miss, PERF_COUNT_HW_BRANCH_MISSES};
+    int first_errno = 0;
+    for (size_t e = 0; e < num_events; ++e){
+        fds[e] = detail::open_event(types[e], configs[e]);
+        if (fds[e] >= 0) ++num_open;
+        else if (first_errno == 0) first_errno = errno;
+    }
+    if (num_open == 0) reason = std::string("perf_event_open: ") + std::strerror(first_errno);
+}
+
+inline perf_counters::~perf_counters() {
+    for (int fd : fds) if (fd >= 0) close(fd);
+}
+
+inline void perf_counters::start() noexcept {
+    for (int fd : fds){
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+inline void perf_counters::stop() noexcept {
+    for (int fd : fds) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    for (size_t e = 0; e < num_events; ++e){
+        if (fds[e] < 0) continue;
+        uint64_t buf[3];    // value, time enabled, time running
+        if (read(fds[e], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) continue;
+        double value = static_cast<double>(buf[0]);
+        if (buf[2] != 0 && buf[2] < buf[1]) value *= static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+        totals[e] += value;
+    }
+}
+
+#else
+
+inline perf_counters::perf_counters(bool) : fds(), totals(), num_open(0), reason("hardware counters need Linux perf_event_open") {
+    for (int &fd : fds) fd = -1;
+}
+
+inline perf_counters::~perf_counters() {}
+inline void perf_counters::start() noexcept {}
+inline void perf_counters::stop() noexcept {}
+
+#endif
+
+inline void perf_counters::reset() noexcept {
+    for (double &t : totals) t = 0.0;
+}
+
+} // namespace bench
+} // namespace jrd
+
+#endif
@@ -0,0 +1,117 @@
+#include "algo.h"
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+void test_reductions(){
+    jrd::vector<std::uint64_t> vec;
+    std::vector<std::uint64_t> ref;
+    for (std::uint64_t i = 0; i < 10007; ++i){
+        const std::uint64_t v = (i * 2654435761u) % 100003 + 5;
+        vec.push_back(v);
+        ref.push_back(v);
+    }
+    // value with the top bit set checks the unsigned compare
+    vec.push_back(0x8000000000000001ull);
+    ref.push_back(0x8000000000000001ull);
+
+    assert(jrd::algo::accumulate(vec, std::uint64_t(0)) == std::accumulate(ref.begin(), ref.end(), std::uint64_t(0)));
+    assert(jrd::algo::min(vec) == *std::min_element(ref.begin(), ref.end()));
+    assert(jrd::algo::max(vec) == *std::max_element(ref.begin(), ref.end()));
+
+    jrd::vector<double> vecd;
+    double sum = 0.0;
+    for (size_t i = 0; i < 5003; ++i){
+        vecd.push_back(static_cast<double>(i % 97) - 50.0);
+        sum += static_cast<double>(i % 97) - 50.0;
+    }
+    assert(jrd::algo::accumulate(vecd, 0.0) == sum);
+    assert(jrd::algo::min(vecd) == -50.0);
+    assert(jrd::algo::max(vecd) == 46.0);
+
+    jrd::vector<std::uint64_t> empty;
+    bool thrown = false;
+    try { jrd::algo::min(empty); } catch (const std::out_of_range &) { thrown = true; }
+    assert(thrown);
+    assert(jrd::algo::accumulate(empty, std::uint64_t(3)) == 3);
+}
+
+void test_searches(){
+    jrd::vector<std::uint64_t> vec;
+    for (std::uint64_t i = 0; i < 10000; ++i){
+        vec.push_back(i % 1000);
+    }
+    assert(jrd::algo::find_index(vec, std::uint64_t(999)) == 999);
+    assert(jrd::algo::find_index(vec, std::uint64_t(1000)) == vec.size());
+    assert(*jrd::algo::find(vec, std::uint64_t(17)) == 17);
+    assert(jrd::algo::find(vec, std::uint64_t(5000)) == vec.end());
+    assert(jrd::algo::count(vec, std::uint64_t(3)) == 10);
+    assert(jrd::algo::count_if(vec, [](std::uint64_t v){ return v < 100; }) == 1000);
+
+    jrd::vector<double> vecd;
+    for (size_t i = 0; i < 3000; ++i){
+        vecd.push_back(static_cast<double>(i));
+    }
+    assert(jrd::algo::find_index(vecd, 2999.0) == 2999);
+    assert(jrd::algo::count(vecd, 12.0) == 1);
+
+    jrd::vector<std::string> vecs;
+    vecs.push_back("a");
+    vecs.push_back("b");
+    assert(jrd::algo::find_index(vecs, std::string("b")) == 1);
+}
+
+void test_writes(){
+    jrd::vector<std::uint64_t> vec;
+    for (std::uint64_t i = 0; i < 4099; ++i){
+        vec.push_back(i);
+    }
+    jrd::algo::transform(vec, [](std::uint64_t v){ return v * 3; });
+    for (size_t i = 0; i < vec.size(); ++i){
+        assert(vec[i] == i * 3);
+    }
+
+    jrd::vector<double> out;
+    for (size_t i = 0; i < vec.size(); ++i){
+        out.push_back(0.0);
+    }
+    jrd::algo::transform(vec, out, [](std::uint64_t v){ return static_cast<double>(v) / 3.0; });
+    for (size_t i = 0; i < out.size(); ++i){
+        assert(out[i] == static_cast<double>(i));
+    }
+
+    // a destination with its own block layout
+    jrd::vector<std::uint64_t, std::allocator<std::uint64_t>, jrd::fixed_growth<64>> fixed;
+    fixed.grow_by(vec.size());
+    jrd::algo::transform(vec, fixed, [](std::uint64_t v){ return v + 1; });
+    for (size_t i = 0; i < fixed.size(); ++i){
+        assert(fixed[i] == i * 3 + 1);
+    }
+    jrd::vector<std::uint64_t, std::allocator<std::uint64_t>, jrd::doubling_growth<16, 4>> stepped;
+    stepped.grow_by(vec.size());
+    jrd::algo::transform(fixed, stepped, [](std::uint64_t v){ return v - 1; });
+    for (size_t i = 0; i < stepped.size(); ++i){
+        assert(stepped[i] == i * 3);
+    }
+
+    jrd::algo::fill(vec, std::uint64_t(9));
+    assert(jrd::algo::count(vec, std::uint64_t(9)) == vec.size());
+    jrd::algo::fill(out, 1.5);
+    assert(jrd::algo::accumulate(out, 0.0) == 1.5 * static_cast<double>(out.size()));
+}
+
+int main(){
+    const jrd::algo::isa levels[] = { jrd::algo::isa::scalar, jrd::algo::isa::sse2, jrd::algo::isa::avx2 };
+    for (auto level : levels){
+        jrd::algo::set_isa(level);
+        test_reductions();
+        test_searches();
+        test_writes();
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "algo.h"
+#include <cstdint>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <iostream>
+#include <sys/time.h>
+
+typedef unsigned long long timestamp_t;
+
+static timestamp_t get_timestamp (){
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+}
+
+static const char * isa_name(jrd::algo::isa level){
+    switch (level){
+        case jrd::algo::isa::avx2: return "avx2";
+        case jrd::algo::isa::sse2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+/*
+ * times f over num_iterations runs and prints the mean, f returns a value
+ * folded into sink so the work cannot be dropped
+ */
+template <class Function>
+void report(const char * name, size_t num_iterations, Function f){
+    static std::uint64_t sink = 0;
+    long double total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        timestamp_t t0 = get_timestamp();
+        sink += static_cast<std::uint64_t>(f());
+        timestamp_t t1 = get_timestamp();
+        total += (t1 - t0);
+    }
+    long double secs = (total / num_iterations) / 1000000.0L;
+    std::cout << name << " took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+}
+
+void algo_uint64(size_t num_iterations, size_t num_append){
+    jrd::vector<std::uint64_t> jvec;
+    std::vector<std::uint64_t> svec;
+    for (std::uint64_t i = 0; i < num_append; ++i){
+        jvec.push_back(i);
+        svec.push_back(i);
+    }
+    const std::uint64_t missing = num_append + 1;
+
+    report("jrd::algo::accumulate<uint64>", num_iterations, [&]{ return jrd::algo::accumulate(jvec, std::uint64_t(0)); });
+    report("std::accumulate<uint64>      ", num_iterations, [&]{ return std::accumulate(svec.begin(), svec.end(), std::uint64_t(0)); });
+    report("jrd::algo::max<uint64>       ", num_iterations, [&]{ return jrd::algo::max(jvec); });
+    report("std::max_element<uint64>     ", num_iterations, [&]{ return *std::max_element(svec.begin(), svec.end()); });
+    report("jrd::algo::find<uint64>      ", num_iterations, [&]{ return jrd::algo::find_index(jvec, missing); });
+    report("std::find<uint64>            ", num_iterations, [&]{ return std::find(svec.begin(), svec.end(), missing) - svec.begin(); });
+    report("jrd::algo::count<uint64>     ", num_iterations, [&]{ return jrd::algo::count(jvec, std::uint64_t(7)); });
+    report("std::count<uint64>           ", num_iterations, [&]{ return std::count(svec.begin(), svec.end(), std::uint64_t(7)); });
+    report("jrd::algo::count_if<uint64>  ", num_iterations, [&]{ return jrd::algo::count_if(jvec, [](std::uint64_t v){ return v & 1; }); });
+    report("std::count_if<uint64>        ", num_iterations, [&]{ return std::count_if(svec.begin(), svec.end(), [](std::uint64_t v){ return v & 1; }); });
+    report("jrd::algo::transform<uint64> ", num_iterations, [&]{ jrd::algo::transform(jvec, [](std::uint64_t v){ return v + 1; }); return jvec[0]; });
+    report("std::transform<uint64>       ", num_iterations, [&]{ std::transform(svec.begin(), svec.end(), svec.begin(), [](std::uint64_t v){ return v + 1; }); return svec[0]; });
+    report("jrd::algo::fill<uint64>      ", num_iterations, [&]{ jrd::algo::fill(jvec, std::uint64_t(3)); return jvec[0]; });
+    report("std::fill<uint64>            ", num_iterations, [&]{ std::fill(svec.begin(), svec.end(), std::uint64_t(3)); return svec[0]; });
+}
+
+void algo_double(size_t num_iterations, size_t num_append){
+    jrd::vector<double> jvec;
+    std::vector<double> svec;
+    for (size_t i = 0; i < num_append; ++i){
+        jvec.push_back(static_cast<double>(i));
+        svec.push_back(static_cast<double>(i));
+    }
+
+    report("jrd::algo::accumulate<double>", num_iterations, [&]{ return jrd::algo::accumulate(jvec, 0.0); });
+    report("std::accumulate<double>      ", num_iterations, [&]{ return std::accumulate(svec.begin(), svec.end(), 0.0); });
+    report("jrd::algo::min<double>       ", num_iterations, [&]{ return jrd::algo::min(jvec); });
+    report("std::min_element<double>     ", num_iterations, [&]{ return *std::min_element(svec.begin(), svec.end()); });
+    report("jrd::algo::find<double>      ", num_iterations, [&]{ return jrd::algo::find_index(jvec, -1.0); });
+    report("std::find<double>            ", num_iterations, [&]{ return std::find(svec.begin(), svec.end(), -1.0) - svec.begin(); });
+}
+
+void algo_tests(size_t num_append){
+    std::cout << "algo " << num_append << " elements" << std::endl;
+    algo_uint64(20, num_append);
+    algo_double(20, num_append);
+}
+
+int main(){
+    const jrd::algo::isa levels[] = { jrd::algo::isa::scalar, jrd::algo::isa::sse2, jrd::algo::isa::avx2 };
+    for (auto level : levels){
+        jrd::algo::set_isa(level);
+        if (jrd::algo::active_isa() != level) continue;
+        std::cout << "kernels: " << isa_name(level) << std::endl;
+        algo_tests(10000);
+        algo_tests(1000000);
+    }
+}
@@ -0,0 +1,72 @@
+#include "vector.h"
+#include "allocator.h"
+#include <cassert>
+#include <string>
+
+void test_block_pool(){
+    jrd::block_pool pool;
+    void * a = pool.allocate(100);
+    pool.deallocate(a, 100);
+    assert(pool.cached_bytes() == 128);
+
+    // same size class comes back from the free list
+    void * b = pool.allocate(128);
+    assert(a == b);
+    assert(pool.cached_bytes() == 0);
+    pool.deallocate(b, 128);
+
+    pool.release();
+    assert(pool.cached_bytes() == 0);
+}
+
+void test_pool_vector(){
+    jrd::block_pool pool;
+    typedef jrd::vector<size_t, jrd::pool_allocator<size_t>> pool_vector;
+
+    size_t cached_after_first = 0;
+    for (size_t round = 0; round < 4; ++round){
+        pool_vector vec{jrd::pool_allocator<size_t>(pool)};
+        for (size_t i = 0; i < 10000; ++i){
+            vec.push_back(i);
+        }
+        for (size_t i = 0; i < 10000; ++i){
+            assert(vec[i] == i);
+        }
+        vec.clear();
+        if (round == 0) cached_after_first = pool.cached_bytes();
+        // every later round is served from blocks the first one gave back
+        assert(pool.cached_bytes() == cached_after_first);
+    }
+    assert(cached_after_first >= 10000 * sizeof(size_t));
+
+    jrd::vector<std::string, jrd::pool_allocator<std::string>> vecs;
+    for (size_t i = 0; i < 1000; ++i){
+        vecs.emplace_back("word " + std::to_string(i));
+    }
+    assert(vecs[999] == "word 999");
+}
+
+void test_arena_vector(){
+    jrd::monotonic_arena arena(1024);
+    {
+        typedef jrd::vector<std::string, jrd::arena_allocator<std::string>> arena_vector;
+        arena_vector vec{jrd::arena_allocator<std::string>(arena)};
+        for (size_t i = 0; i < 5000; ++i){
+            vec.push_back(std::to_string(i));
+        }
+        for (size_t i = 0; i < 5000; ++i){
+            assert(vec[i] == std::to_string(i));
+        }
+        assert(arena.allocated_bytes() >= 5000 * sizeof(std::string));
+    }
+    arena.release();
+    assert(arena.allocated_bytes() == 0);
+}
+
+int main(){
+    test_block_pool();
+    test_pool_vector();
+    test_arena_vector();
+
+    return 0;
+}
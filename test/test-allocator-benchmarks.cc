@@ -0,0 +1,83 @@
+#include "vector.h"
+#include "allocator.h"
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sys/time.h>
+
+typedef unsigned long long timestamp_t;
+
+static timestamp_t get_timestamp (){
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+}
+
+void build_clear(size_t num_iterations, size_t num_append);
+
+int main(){
+    std::cout << "build/clear 100 times" << std::endl;
+    build_clear(10000, 100);
+
+    std::cout << "build/clear 1000 times" << std::endl;
+    build_clear(2000, 1000);
+
+    std::cout << "build/clear 10000 times" << std::endl;
+    build_clear(500, 10000);
+
+    std::cout << "build/clear 100000 times" << std::endl;
+    build_clear(50, 100000);
+}
+
+template <class Vec>
+size_t fill(Vec &vec, size_t num_append){
+    for (size_t i = 0; i < num_append; ++i){
+        vec.push_back(i);
+    }
+    return vec.size();
+}
+
+/*
+ * every cycle builds a fresh vector and throws it away, the pool and arena
+ * versions should stop calling the system allocator after the first cycle
+ */
+template <class Function>
+void cycle(const char * name, size_t num_iterations, Function f){
+    size_t sink = 0;
+    timestamp_t t0 = get_timestamp();
+    for (size_t i = 0; i < num_iterations; ++i){
+        sink += f();
+    }
+    timestamp_t t1 = get_timestamp();
+    long double secs = (static_cast<long double>(t1 - t0) / num_iterations) / 1000000.0L;
+    std::cout << name << " took: " << secs << " seconds per cycle over " << num_iterations << " iterations (" << sink << ")" << std::endl;
+}
+
+void build_clear(size_t num_iterations, size_t num_append){
+    cycle("std::vector<size_t>                ", num_iterations, [&]{
+        std::vector<size_t> vec;
+        return fill(vec, num_append);
+    });
+    cycle("jrd::vector<size_t>                ", num_iterations, [&]{
+        jrd::vector<size_t> vec;
+        return fill(vec, num_append);
+    });
+
+    jrd::block_pool pool;
+    cycle("jrd::vector<size_t> block_pool     ", num_iterations, [&]{
+        jrd::vector<size_t, jrd::pool_allocator<size_t>> vec{jrd::pool_allocator<size_t>(pool)};
+        return fill(vec, num_append);
+    });
+
+    jrd::monotonic_arena arena;
+    cycle("jrd::vector<size_t> monotonic_arena", num_iterations, [&]{
+        size_t n;
+        {
+            jrd::vector<size_t, jrd::arena_allocator<size_t>> vec{jrd::arena_allocator<size_t>(arena)};
+            n = fill(vec, num_append);
+        }
+        // one request done, drop everything it allocated at once
+        arena.release();
+        return n;
+    });
+}
@@ -0,0 +1,233 @@
+#include "concurrent_vector.h"
+#include "vector.h"
+#include <cassert>
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+void test_single_thread(){
+    jrd::concurrent_vector<std::string> vec;
+    assert(vec.empty());
+    for (size_t i = 0; i < 1000; ++i){
+        assert(vec.push_back("word " + std::to_string(i)) == i);
+    }
+    assert(vec.size() == 1000);
+    for (size_t i = 0; i < 1000; ++i){
+        assert(vec[i] == "word " + std::to_string(i));
+    }
+
+    const std::string * first = &vec[0];
+    const size_t at = vec.grow_by(5000, "filler");
+    assert(at == 1000);
+    assert(vec.size() == 6000);
+    assert(vec[5999] == "filler");
+    assert(&vec[0] == first);
+    assert(vec.capacity() >= vec.size());
+
+    bool thrown = false;
+    try { vec.at(6000); } catch (const std::out_of_range &) { thrown = true; }
+    assert(thrown);
+
+    vec.clear();
+    assert(vec.empty());
+    assert(vec.capacity() == 0);
+}
+
+// counts live objects, the constructors throw once countdown reaches zero
+struct brittle {
+    static int live;
+    static int countdown;
+
+    static void tick(){
+        if (countdown > 0 && --countdown == 0) throw std::runtime_error("brittle");
+    }
+
+    brittle() : value(7) { tick(); ++live; }
+    explicit brittle(int v) : value(v) { tick(); ++live; }
+    brittle(const brittle &other) : value(other.value) { tick(); ++live; }
+    ~brittle() { --live; }
+    brittle & operator = (const brittle &) = default;
+
+    int value;
+};
+int brittle::live = 0;
+int brittle::countdown = 0;
+
+void test_throwing_constructor(){
+    {
+        jrd::concurrent_vector<brittle> vec;
+        vec.push_back(brittle(1));
+
+        // the fifth default constructor throws, slots 5 to 39 stay holes
+        brittle::countdown = 5;
+        bool thrown = false;
+        try { vec.grow_by(40); } catch (const std::runtime_error &) { thrown = true; }
+        assert(thrown && vec.size() == 41 && brittle::live == 5);
+        assert(vec.at(4).value == 7);
+        thrown = false;
+        try { vec.at(5); } catch (const std::out_of_range &) { thrown = true; }
+        assert(thrown);
+
+        // the third copy throws, across the boundary of blocks 2 and 3
+        const brittle val(9);
+        brittle::countdown = 3;
+        thrown = false;
+        try { vec.grow_by(30, val); } catch (const std::runtime_error &) { thrown = true; }
+        assert(thrown && vec.size() == 71 && brittle::live == 8);
+        assert(vec.at(42).value == 9);
+
+        // a throwing push_back leaves one hole and the vector goes on
+        brittle::countdown = 1;
+        thrown = false;
+        try { vec.push_back(val); } catch (const std::runtime_error &) { thrown = true; }
+        assert(thrown && vec.size() == 72);
+        assert(vec[vec.push_back(val)].value == 9);
+
+        vec.clear();
+        assert(brittle::live == 1);
+    }
+    assert(brittle::live == 0);
+}
+
+struct alignas(128) cache_line_pair {
+    size_t value;
+};
+
+void test_over_aligned(){
+    jrd::concurrent_vector<cache_line_pair> vec;
+    for (size_t i = 0; i < 200; ++i){
+        const size_t idx = vec.push_back(cache_line_pair{i});
+        assert(reinterpret_cast<uintptr_t>(&vec[idx]) % alignof(cache_line_pair) == 0);
+    }
+    for (size_t i = 0; i < vec.size(); ++i) assert(vec[i].value == i);
+    // 16 + 16 + 32 + 64 + 128
+    assert(vec.capacity() == 256);
+    vec.clear();
+    assert(vec.empty() && vec.capacity() == 0);
+}
+
+void test_many_producers(){
+    const size_t num_threads = 8;
+    const size_t per_thread = 20000;
+    jrd::concurrent_vector<size_t> vec;
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<size_t>> handed_out(num_threads);
+    for (size_t t = 0; t < num_threads; ++t){
+        threads.emplace_back([&, t]{
+            for (size_t i = 0; i < per_thread; ++i){
+                const size_t value = t * per_thread + i;
+                size_t idx;
+                if (i % 100 == 0){
+                    idx = vec.grow_by(1, value);
+                } else {
+                    idx = vec.push_back(value);
+                }
+                handed_out[t].push_back(idx);
+                // our own element is readable straight away
+                assert(vec[idx] == value);
+            }
+        });
+    }
+    for (auto &th : threads) th.join();
+
+    assert(vec.size() == num_threads * per_thread);
+    std::vector<size_t> seen(num_threads * per_thread, 0);
+    for (size_t t = 0; t < num_threads; ++t){
+        for (size_t i = 0; i < per_thread; ++i){
+            assert(vec[handed_out[t][i]] == t * per_thread + i);
+            ++seen[vec[handed_out[t][i]]];
+        }
+    }
+    assert(std::all_of(seen.begin(), seen.end(), [](size_t c){ return c == 1; }));
+}
+
+/*
+ * one thread appends through every append path while the readers check
+ * that the newest index they can see, and a random older one, hold their
+ * values. Reads go through a const reference with no lock.
+ */
+template <typename T, class Make>
+void single_writer_stress(size_t total, size_t num_readers, Make make){
+    typedef jrd::vector<T, std::allocator<T>, jrd::single_writer<>> vec_type;
+    vec_type vec;
+    const vec_type & cvec = vec;
+
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < num_readers; ++r){
+        readers.emplace_back([&, r]{
+            size_t last = 0;
+            unsigned long long x = r + 1;
+            while (last < total){
+                const size_t n = cvec.size();
+                if (n < last) failed = true;
+                last = n;
+                if (n == 0) continue;
+                if (!(cvec[n - 1] == make(n - 1))) failed = true;
+                x = x * 6364136223846793005ull + 1442695040888963407ull;
+                const size_t i = static_cast<size_t>(x >> 11) % n;
+                if (!(cvec.at(i) == make(i))) failed = true;
+            }
+        });
+    }
+
+    std::vector<T> batch;
+    for (size_t next = 0; next < total; next += 1000){
+        switch ((next / 1000) % 3){
+            case 0:
+                for (size_t i = next; i < next + 1000; ++i) vec.push_back(make(i));
+                break;
+            case 1:
+                batch.clear();
+                for (size_t i = next; i < next + 1000; ++i) batch.push_back(make(i));
+                vec.append(batch.data(), batch.size());
+                break;
+            default:
+                for (size_t i = next; i < next + 1000; ++i) vec.emplace_back(make(i));
+                break;
+        }
+    }
+    for (auto &th : readers) th.join();
+    assert(!failed);
+    assert(vec.size() == total);
+}
+
+void test_single_writer(){
+    single_writer_stress<size_t>(3000000, 4, [](size_t i){ return i * 3; });
+    single_writer_stress<std::string>(300000, 4, [](size_t i){ return "value " + std::to_string(i); });
+
+    // the mode composes with an inline first block
+    jrd::vector<size_t, std::allocator<size_t>, jrd::single_writer<jrd::inline_first_block<>>> small;
+    for (size_t i = 0; i < 100; ++i){
+        small.push_back(i);
+    }
+    assert(small.size() == 100 && small[99] == 99);
+
+    // readers can see grow_by's slots before they are written, so they
+    // start out value initialized instead of holding whatever was there
+    jrd::vector<size_t, std::allocator<size_t>, jrd::single_writer<>> grown;
+    for (int round = 0; round < 2; ++round){
+        for (auto seg : grown.grow_by(5000)){
+            for (size_t i = 0; i < seg.size(); ++i){
+                assert(seg.data()[i] == 0);
+                seg.data()[i] = 7;
+            }
+        }
+        grown.clear();
+    }
+}
+
+int main(){
+    test_single_thread();
+    test_over_aligned();
+    test_throwing_constructor();
+    test_many_producers();
+    test_single_writer();
+
+    return 0;
+}
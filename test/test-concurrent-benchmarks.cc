@@ -0,0 +1,163 @@
+#include "concurrent_vector.h"
+#include "vector.h"
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+typedef unsigned long long timestamp_t;
+
+static timestamp_t get_timestamp (){
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+}
+
+void producers(size_t num_iterations, size_t num_append, size_t num_threads);
+void readers(size_t num_iterations, size_t num_reads, size_t num_threads);
+
+int main(){
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads < 4) max_threads = 4;
+
+    const size_t sizes[] = { 100000, 1000000, 10000000 };
+    for (size_t n : sizes){
+        std::cout << "push_back " << n << " times" << std::endl;
+        for (size_t t = 1; t <= max_threads; t *= 2){
+            producers(10, n, t);
+        }
+    }
+
+    std::cout << "1000000 reads per reader under one writer" << std::endl;
+    for (size_t t = 1; t <= max_threads; t *= 2){
+        readers(10, 1000000, t);
+    }
+}
+
+// run f(thread) on num_threads threads and return the wall time in microseconds
+template <class Function>
+timestamp_t time_threads(size_t num_threads, Function f){
+    std::vector<std::thread> threads;
+    timestamp_t t0 = get_timestamp();
+    for (size_t t = 0; t < num_threads; ++t) threads.emplace_back(f, t);
+    for (auto &th : threads) th.join();
+    return get_timestamp() - t0;
+}
+
+void producers(size_t num_iterations, size_t num_append, size_t num_threads){
+    const size_t per_thread = num_append / num_threads;
+
+    long double total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        jrd::concurrent_vector<size_t> vec;
+        total += time_threads(num_threads, [&](size_t t){
+            for (size_t j = 0; j < per_thread; ++j) vec.push_back(t + j);
+        });
+    }
+    long double secs = (total / num_iterations) / 1000000.0L;
+    std::cout << num_threads << " threads jrd::concurrent_vector<size_t> took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        jrd::concurrent_vector<size_t> vec;
+        total += time_threads(num_threads, [&](size_t t){
+            for (size_t j = 0; j < per_thread; j += 64){
+                const size_t first = vec.grow_by(64);
+                for (size_t k = 0; k < 64; ++k) vec[first + k] = t + j + k;
+            }
+        });
+    }
+    secs = (total / num_iterations) / 1000000.0L;
+    std::cout << num_threads << " threads jrd::concurrent_vector<size_t> grow_by(64) took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        std::vector<size_t> vec;
+        std::mutex lock;
+        total += time_threads(num_threads, [&](size_t t){
+            for (size_t j = 0; j < per_thread; ++j){
+                std::lock_guard<std::mutex> guard(lock);
+                vec.push_back(t + j);
+            }
+        });
+    }
+    secs = (total / num_iterations) / 1000000.0L;
+    std::cout << num_threads << " threads mutex std::vector<size_t> took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+}
+
+
+static std::atomic<size_t> read_sink(0);
+
+/*
+ * num_threads readers each make num_reads random reads below the size
+ * they last saw while one writer keeps appending, timed until the last
+ * reader is done. The vectors start with 1M elements.
+ */
+template <class Read, class Write>
+timestamp_t time_readers(size_t num_threads, size_t num_reads, Read read, Write write){
+    std::atomic<bool> stop(false);
+    std::thread writer([&]{
+        size_t i = 1000000;
+        while (!stop.load(std::memory_order_relaxed)) write(i++);
+    });
+    const timestamp_t t = time_threads(num_threads, [&](size_t r){
+        unsigned long long x = r + 1;
+        size_t sum = 0;
+        for (size_t j = 0; j < num_reads; ++j){
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+            sum += read(static_cast<size_t>(x >> 11));
+        }
+        read_sink += sum;
+    });
+    stop = true;
+    writer.join();
+    return t;
+}
+
+void readers(size_t num_iterations, size_t num_reads, size_t num_threads){
+    typedef jrd::vector<size_t, std::allocator<size_t>, jrd::single_writer<>> sw_vector;
+
+    long double total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        sw_vector vec;
+        const sw_vector & cvec = vec;
+        for (size_t j = 0; j < 1000000; ++j) vec.push_back(j);
+        total += time_readers(num_threads, num_reads,
+            [&](size_t r){ return cvec[r % cvec.size()]; },
+            [&](size_t v){ vec.push_back(v); });
+    }
+    long double secs = (total / num_iterations) / 1000000.0L;
+    std::cout << num_threads << " readers jrd::vector<size_t> single_writer took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        jrd::concurrent_vector<size_t> vec;
+        for (size_t j = 0; j < 1000000; ++j) vec.push_back(j);
+        total += time_readers(num_threads, num_reads,
+            [&](size_t r){ return vec[r % vec.size()]; },
+            [&](size_t v){ vec.push_back(v); });
+    }
+    secs = (total / num_iterations) / 1000000.0L;
+    std::cout << num_threads << " readers jrd::concurrent_vector<size_t> took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        std::vector<size_t> vec;
+        std::shared_mutex lock;
+        for (size_t j = 0; j < 1000000; ++j) vec.push_back(j);
+        total += time_readers(num_threads, num_reads,
+            [&](size_t r){
+                std::shared_lock<std::shared_mutex> guard(lock);
+                return vec[r % vec.size()];
+            },
+            [&](size_t v){
+                std::unique_lock<std::shared_mutex> guard(lock);
+                vec.push_back(v);
+            });
+    }
+    secs = (total / num_iterations) / 1000000.0L;
+    std::cout << num_threads << " readers shared_mutex std::vector<size_t> took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+}
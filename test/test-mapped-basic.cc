@@ -0,0 +1,124 @@
+#include "mapped_vector.h"
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <unistd.h>
+
+struct record {
+    std::uint64_t id;
+    double value;
+    char tag[8];
+};
+
+static std::string temp_path(){
+    char path[] = "/tmp/jrd-mapped-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    unlink(path);
+    return path;
+}
+
+void test_create_and_reopen(){
+    const std::string path = temp_path();
+    {
+        jrd::mapped_vector<std::uint64_t> vec(path);
+        assert(vec.empty());
+        assert(vec.capacity() == 0);
+        for (std::uint64_t i = 0; i < 100000; ++i){
+            vec.push_back(i * 3);
+        }
+        assert(vec.size() == 100000);
+        assert(vec.capacity() >= 100000);
+        assert(vec[99999] == 99999 * 3);
+    }
+    {
+        // nothing is rebuilt, the blocks are mapped straight from the file
+        jrd::mapped_vector<std::uint64_t> vec(path);
+        assert(vec.size() == 100000);
+        for (std::uint64_t i = 0; i < 100000; ++i){
+            assert(vec[i] == i * 3);
+        }
+
+        std::uint64_t more[5000];
+        for (std::uint64_t i = 0; i < 5000; ++i) more[i] = 100000 + i;
+        vec.append(more, 5000);
+        vec.push_back(7);
+        vec.sync();
+    }
+    {
+        jrd::mapped_vector<std::uint64_t> vec(path);
+        assert(vec.size() == 105001);
+        assert(vec[100000] == 100000);
+        assert(vec[104999] == 104999);
+        assert(vec.at(105000) == 7);
+
+        bool thrown = false;
+        try { vec.at(105001); } catch (const std::out_of_range &) { thrown = true; }
+        assert(thrown);
+
+        size_t total = 0;
+        vec.for_each_segment([&](jrd::mapped_vector<std::uint64_t>::segment seg){ total += seg.size(); });
+        assert(total == 105001);
+
+        vec.clear();
+        assert(vec.empty());
+        vec.push_back(11);
+    }
+    {
+        jrd::mapped_vector<std::uint64_t> vec(path);
+        assert(vec.size() == 1);
+        assert(vec[0] == 11);
+    }
+    unlink(path.c_str());
+}
+
+void test_records(){
+    const std::string path = temp_path();
+    {
+        jrd::mapped_vector<record> vec(path);
+        for (std::uint64_t i = 0; i < 10000; ++i){
+            vec.push_back(record{i, static_cast<double>(i) / 2, "tag"});
+        }
+    }
+    {
+        jrd::mapped_vector<record> vec(path);
+        assert(vec.size() == 10000);
+        assert(vec[9999].id == 9999);
+        assert(vec[9999].value == 9999.0 / 2);
+        assert(std::string(vec[9999].tag) == "tag");
+    }
+
+    // a different element type is refused
+    bool thrown = false;
+    try { jrd::mapped_vector<std::uint32_t> wrong(path); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+
+    // so is a policy with the same first block but a different chain,
+    // 4096 element blocks doubling every block against every other block
+    thrown = false;
+    try { jrd::mapped_vector<record, jrd::doubling_growth<8192, 2>> wrong(path); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+    unlink(path.c_str());
+}
+
+void test_bad_file(){
+    const std::string path = temp_path();
+    FILE * f = fopen(path.c_str(), "w");
+    fputs("not a vector at all, just some text that is long enough", f);
+    fclose(f);
+
+    bool thrown = false;
+    try { jrd::mapped_vector<std::uint64_t> vec(path); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+    unlink(path.c_str());
+}
+
+int main(){
+    test_create_and_reopen();
+    test_records();
+    test_bad_file();
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "mapped_vector.h"
+#include "vector.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+typedef unsigned long long timestamp_t;
+
+static timestamp_t get_timestamp (){
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+}
+
+static void report(const char * name, timestamp_t t0, timestamp_t t1, std::uint64_t sink){
+    long double secs = static_cast<long double>(t1 - t0) / 1000000.0L;
+    std::cout << name << " took: " << secs << " seconds (" << sink % 10 << ")" << std::endl;
+}
+
+void cold_start(size_t num_append);
+
+int main(){
+    std::cout << "mapped 1000000 elements" << std::endl;
+    cold_start(1000000);
+
+    std::cout << "mapped 20000000 elements" << std::endl;
+    cold_start(20000000);
+}
+
+/*
+ * the startup path we are replacing: a column saved as a flat file is
+ * read back and appended into a jrd::vector, against reopening a
+ * jrd::mapped_vector of the same column
+ */
+void cold_start(size_t num_append){
+    const std::string mapped_path = "/tmp/jrd-mapped-bench.vec";
+    const std::string flat_path = "/tmp/jrd-mapped-bench.flat";
+    unlink(mapped_path.c_str());
+
+    std::vector<std::uint64_t> src(num_append);
+    for (size_t i = 0; i < num_append; ++i) src[i] = i;
+
+    timestamp_t t0 = get_timestamp();
+    {
+        jrd::mapped_vector<std::uint64_t> vec(mapped_path);
+        for (size_t i = 0; i < num_append; ++i) vec.push_back(src[i]);
+    }
+    timestamp_t t1 = get_timestamp();
+    report("jrd::mapped_vector push_back build  ", t0, t1, 0);
+
+    unlink(mapped_path.c_str());
+    t0 = get_timestamp();
+    {
+        jrd::mapped_vector<std::uint64_t> vec(mapped_path);
+        vec.append(src.data(), src.size());
+    }
+    t1 = get_timestamp();
+    report("jrd::mapped_vector append build     ", t0, t1, 0);
+
+    int fd = open(flat_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (write(fd, src.data(), src.size() * sizeof(std::uint64_t)) < 0) std::cout << "write failed" << std::endl;
+    close(fd);
+
+    // reopen and touch one element, what a service needs before it can serve
+    std::uint64_t sink = 0;
+    t0 = get_timestamp();
+    {
+        jrd::mapped_vector<std::uint64_t> vec(mapped_path);
+        sink += vec[vec.size() / 2];
+    }
+    t1 = get_timestamp();
+    report("jrd::mapped_vector reopen           ", t0, t1, sink);
+
+    t0 = get_timestamp();
+    {
+        jrd::vector<std::uint64_t> vec;
+        std::vector<std::uint64_t> buf(1 << 16);
+        fd = open(flat_path.c_str(), O_RDONLY);
+        ssize_t got;
+        while ((got = read(fd, buf.data(), buf.size() * sizeof(std::uint64_t))) > 0){
+            vec.append(buf.data(), static_cast<size_t>(got) / sizeof(std::uint64_t));
+        }
+        close(fd);
+        sink += vec[vec.size() / 2];
+    }
+    t1 = get_timestamp();
+    report("jrd::vector read + append reload    ", t0, t1, sink);
+
+    // reopen and scan everything, the page cache is warm for both
+    t0 = get_timestamp();
+    {
+        jrd::mapped_vector<std::uint64_t> vec(mapped_path);
+        vec.for_each_segment([&](jrd::mapped_vector<std::uint64_t>::segment seg){
+            for (std::uint64_t v : seg) sink += v;
+        });
+    }
+    t1 = get_timestamp();
+    report("jrd::mapped_vector reopen + scan    ", t0, t1, sink);
+
+    unlink(mapped_path.c_str());
+    unlink(flat_path.c_str());
+}
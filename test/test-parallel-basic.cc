@@ -0,0 +1,96 @@
+#include "parallel.h"
+#include <cassert>
+#include <atomic>
+#include <stdexcept>
+
+void test_thread_pool(){
+    jrd::thread_pool pool(4);
+    assert(pool.size() == 4);
+
+    std::atomic<size_t> sum(0);
+    pool.run(1000, [&](size_t i){ sum += i; });
+    assert(sum == 1000 * 999 / 2);
+
+    // nested runs must not deadlock
+    std::atomic<size_t> inner(0);
+    pool.run(8, [&](size_t){
+        pool.run(8, [&](size_t){ ++inner; });
+    });
+    assert(inner == 64);
+
+    bool thrown = false;
+    try {
+        pool.run(16, [](size_t i){ if (i == 7) throw std::runtime_error("task failed"); });
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_parallel_algorithms(){
+    jrd::thread_pool pool(3);
+    jrd::vector<size_t> vec;
+    for (size_t i = 0; i < 100000; ++i){
+        vec.push_back(i);
+    }
+
+    // small grain so the big blocks get split into many tasks
+    jrd::parallel::for_each(vec, [](size_t &v){ v *= 2; }, pool, 1000);
+    for (size_t i = 0; i < vec.size(); ++i){
+        assert(vec[i] == 2 * i);
+    }
+
+    assert(jrd::parallel::reduce(vec, size_t(0), pool) == 100000ull * 99999ull);
+    assert(jrd::parallel::reduce(vec, size_t(0), [](size_t a, size_t b){ return a > b ? a : b; }, pool, 777) == 2 * 99999);
+
+    // no default constructor, the partial results must not need one
+    struct meters {
+        explicit meters(double in_value) : value(in_value) {}
+        double value;
+    };
+    jrd::vector<meters> lengths;
+    for (size_t i = 0; i < 5000; ++i) lengths.emplace_back(static_cast<double>(i % 10));
+    const meters total = jrd::parallel::reduce(lengths, meters(1.0), [](const meters &a, const meters &b){ return meters(a.value + b.value); }, pool, 100);
+    assert(total.value == 1.0 + 500.0 * 45.0);
+
+    jrd::vector<double> out;
+    for (size_t i = 0; i < vec.size(); ++i){
+        out.push_back(0.0);
+    }
+    jrd::parallel::transform(vec, out, [](size_t v){ return static_cast<double>(v) / 2.0; }, pool, 500);
+    for (size_t i = 0; i < out.size(); ++i){
+        assert(out[i] == static_cast<double>(i));
+    }
+
+    // out shares its blocks with keep, the tasks must not race to clone them
+    jrd::vector<double> keep(out);
+    jrd::parallel::transform(vec, out, [](size_t v){ return static_cast<double>(v); }, pool, 500);
+    for (size_t i = 0; i < out.size(); ++i){
+        assert(out[i] == static_cast<double>(2 * i));
+        assert(keep[i] == static_cast<double>(i));
+    }
+
+    // different policies, a src chunk can straddle dst blocks
+    jrd::vector<size_t, std::allocator<size_t>, jrd::fixed_growth<64>> fixed;
+    fixed.grow_by(vec.size());
+    jrd::parallel::transform(vec, fixed, [](size_t v){ return v + 1; }, pool, 1000);
+    for (size_t i = 0; i < fixed.size(); ++i){
+        assert(fixed[i] == 2 * i + 1);
+    }
+    jrd::vector<size_t> back;
+    back.grow_by(fixed.size());
+    jrd::parallel::transform(fixed, back, [](size_t v){ return v - 1; }, pool, 100);
+    for (size_t i = 0; i < back.size(); ++i){
+        assert(back[i] == 2 * i);
+    }
+
+    jrd::vector<size_t> empty;
+    assert(jrd::parallel::reduce(empty, size_t(5), pool) == 5);
+}
+
+int main(){
+    test_thread_pool();
+    test_parallel_algorithms();
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "parallel.h"
+#include <vector>
+#include <numeric>
+#include <iostream>
+#include <thread>
+#include <sys/time.h>
+
+typedef unsigned long long timestamp_t;
+
+static timestamp_t get_timestamp (){
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+}
+
+void parallel_scaling(size_t num_iterations, size_t num_append, size_t num_threads);
+
+int main(){
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads == 0) max_threads = 1;
+
+    const size_t sizes[] = { 100000, 1000000, 10000000 };
+    for (size_t n : sizes){
+        std::cout << "parallel " << n << " elements" << std::endl;
+        for (size_t t = 1; t <= max_threads; t *= 2){
+            parallel_scaling(10, n, t);
+        }
+        if ((max_threads & (max_threads - 1)) != 0) parallel_scaling(10, n, max_threads);
+    }
+}
+
+void parallel_scaling(size_t num_iterations, size_t num_append, size_t num_threads){
+    jrd::thread_pool pool(num_threads);
+    jrd::vector<double> vec;
+    for (size_t i = 0; i < num_append; ++i){
+        vec.push_back(static_cast<double>(i));
+    }
+    jrd::vector<double> out;
+    for (size_t i = 0; i < num_append; ++i){
+        out.push_back(0.0);
+    }
+
+    timestamp_t t0;
+    timestamp_t t1;
+    double sink = 0.0;
+
+    long double total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        t0 = get_timestamp();
+        jrd::parallel::for_each(vec, [](double &v){ v = v * 1.0000001 + 1.0; }, pool);
+        t1 = get_timestamp();
+        total += (t1 - t0);
+    }
+    std::cout << num_threads << " threads for_each took: " << (total / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        t0 = get_timestamp();
+        jrd::parallel::transform(vec, out, [](double v){ return v * v; }, pool);
+        t1 = get_timestamp();
+        total += (t1 - t0);
+    }
+    std::cout << num_threads << " threads transform took: " << (total / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        t0 = get_timestamp();
+        sink += jrd::parallel::reduce(vec, 0.0, pool);
+        t1 = get_timestamp();
+        total += (t1 - t0);
+    }
+    std::cout << num_threads << " threads reduce took: " << (total / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations (" << sink << ")" << std::endl;
+}
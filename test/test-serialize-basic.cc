@@ -0,0 +1,236 @@
+#include "serialize.h"
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+static int temp_fd(){
+    char path[] = "/tmp/jrd-serialize-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+    return fd;
+}
+
+void test_fd_raw(){
+    jrd::vector<std::uint64_t> vec;
+    for (std::uint64_t i = 0; i < 100000; ++i){
+        vec.push_back(i * 7);
+    }
+
+    int fd = temp_fd();
+    jrd::save(vec, fd);
+    assert(lseek(fd, 0, SEEK_CUR) == static_cast<off_t>(64 + 100000 * sizeof(std::uint64_t)));
+
+    lseek(fd, 0, SEEK_SET);
+    jrd::vector<std::uint64_t> back;
+    back.push_back(42);
+    jrd::load(back, fd);
+    assert(back.size() == 100000);
+    for (std::uint64_t i = 0; i < 100000; ++i){
+        assert(back[i] == i * 7);
+    }
+
+    // the byte stream does not depend on the block layout
+    lseek(fd, 0, SEEK_SET);
+    jrd::vector<std::uint64_t, std::allocator<std::uint64_t>, jrd::fixed_growth<1024>> fixed;
+    jrd::load(fixed, fd);
+    assert(fixed.size() == 100000);
+    assert(fixed[99999] == 99999 * 7);
+
+    // a flipped payload byte is caught
+    lseek(fd, 64 + 8 * 500, SEEK_SET);
+    const char junk = 1;
+    assert(write(fd, &junk, 1) == 1);
+    lseek(fd, 0, SEEK_SET);
+    bool thrown = false;
+    try { jrd::load(back, fd); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+    assert(back.empty());
+
+    // and so is the wrong element type
+    lseek(fd, 0, SEEK_SET);
+    jrd::vector<std::uint32_t> narrow;
+    thrown = false;
+    try { jrd::load(narrow, fd); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+    close(fd);
+
+    // empty vectors round trip too
+    jrd::vector<double> empty;
+    fd = temp_fd();
+    jrd::save(empty, fd);
+    lseek(fd, 0, SEEK_SET);
+    jrd::vector<double> empty_back;
+    empty_back.push_back(1.0);
+    jrd::load(empty_back, fd);
+    assert(empty_back.empty());
+    close(fd);
+}
+
+void test_fd_strings(){
+    jrd::vector<std::string> vec;
+    for (size_t i = 0; i < 20000; ++i){
+        vec.push_back("word " + std::to_string(i));
+    }
+    vec.push_back("");
+
+    int fd = temp_fd();
+    jrd::save(vec, fd);
+    lseek(fd, 0, SEEK_SET);
+    jrd::vector<std::string> back;
+    jrd::load(back, fd);
+    assert(back.size() == 20001);
+    for (size_t i = 0; i < 20000; ++i){
+        assert(back[i] == "word " + std::to_string(i));
+    }
+    assert(back[20000].empty());
+    close(fd);
+}
+
+void test_streams(){
+    jrd::vector<std::int32_t> vec;
+    for (std::int32_t i = 0; i < 5000; ++i){
+        vec.push_back(-i);
+    }
+    std::stringstream buf;
+    jrd::save(vec, buf);
+    jrd::vector<std::int32_t> back;
+    jrd::load(back, buf);
+    assert(back.size() == 5000);
+    assert(back[4999] == -4999);
+
+    jrd::vector<std::string> words;
+    words.push_back("alpha");
+    words.push_back("beta");
+    std::stringstream sbuf;
+    jrd::save(words, sbuf);
+    jrd::vector<std::string> words_back;
+    jrd::load(words_back, sbuf);
+    assert(words_back.size() == 2 && words_back[1] == "beta");
+
+    // a truncated stream is an error, not a short vector
+    std::string cut = sbuf.str();
+    cut.resize(cut.size() - 2);
+    std::stringstream short_buf(cut);
+    bool thrown = false;
+    try { jrd::load(words_back, short_buf); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+    assert(words_back.empty());
+}
+
+// rewrites the count and payload_bytes fields of the header at the start of fd
+static void forge_header(int fd, std::uint64_t count, std::uint64_t payload_bytes){
+    assert(pwrite(fd, &count, sizeof(count), 16) == static_cast<ssize_t>(sizeof(count)));
+    assert(pwrite(fd, &payload_bytes, sizeof(payload_bytes), 24) == static_cast<ssize_t>(sizeof(payload_bytes)));
+}
+
+template <typename Vec>
+static bool load_fails(Vec &vec, int fd){
+    lseek(fd, 0, SEEK_SET);
+    try { jrd::load(vec, fd); } catch (const std::runtime_error &) { return vec.empty(); }
+    return false;
+}
+
+void test_corrupted_header(){
+    jrd::vector<std::uint64_t> vec;
+    for (std::uint64_t i = 0; i < 1000; ++i) vec.push_back(i);
+    int fd = temp_fd();
+    jrd::save(vec, fd);
+    jrd::vector<std::uint64_t> back;
+
+    // count * 8 wraps around to the real payload size
+    forge_header(fd, (std::uint64_t(1) << 61) + 1000, 8000);
+    assert(load_fails(back, fd));
+
+    // consistent, but far more than the file holds
+    forge_header(fd, std::uint64_t(1) << 40, std::uint64_t(1) << 43);
+    assert(load_fails(back, fd));
+
+    // the same header on a stream fails at the end of the data, not in reserve()
+    lseek(fd, 0, SEEK_SET);
+    std::string bytes(64 + 8000, '\0');
+    assert(read(fd, &bytes[0], bytes.size()) == static_cast<ssize_t>(bytes.size()));
+    std::stringstream in(bytes);
+    bool thrown = false;
+    try { jrd::load(back, in); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown && back.empty());
+    close(fd);
+
+    // strings whose header claims a shorter payload than they take
+    jrd::vector<std::string> words;
+    words.push_back("first");
+    words.push_back("second");
+    fd = temp_fd();
+    jrd::save(words, fd);
+    jrd::vector<std::string> words_back;
+    forge_header(fd, 2, 20);
+    assert(load_fails(words_back, fd));
+    forge_header(fd, std::uint64_t(1) << 62, 8 + 5 + 8 + 6);
+    assert(load_fails(words_back, fd));
+
+    // a string length far beyond the payload is refused, not allocated
+    forge_header(fd, 2, 8 + 5 + 8 + 6);
+    const std::uint64_t huge = std::uint64_t(1) << 50;
+    assert(pwrite(fd, &huge, sizeof(huge), 64) == static_cast<ssize_t>(sizeof(huge)));
+    assert(load_fails(words_back, fd));
+    lseek(fd, 0, SEEK_SET);
+    std::string forged(64 + 8 + 5 + 8 + 6, '\0');
+    assert(read(fd, &forged[0], forged.size()) == static_cast<ssize_t>(forged.size()));
+    std::stringstream forged_in(forged);
+    thrown = false;
+    try { jrd::load(words_back, forged_in); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown && words_back.empty());
+    close(fd);
+}
+
+void test_fd_records(){
+    jrd::vector<std::string> words;
+    for (size_t i = 0; i < 3000; ++i) words.push_back("w" + std::to_string(i));
+    jrd::vector<std::uint32_t> numbers;
+    for (std::uint32_t i = 0; i < 3000; ++i) numbers.push_back(i * 3);
+
+    // two records back to back, the first one a buffered traits payload
+    int fd = temp_fd();
+    jrd::save(words, fd);
+    jrd::save(numbers, fd);
+    jrd::save(words, fd);
+    lseek(fd, 0, SEEK_SET);
+
+    jrd::vector<std::string> words_back;
+    jrd::vector<std::uint32_t> numbers_back;
+    jrd::load(words_back, fd);
+    jrd::load(numbers_back, fd);
+    assert(words_back == words && numbers_back == numbers);
+    jrd::load(words_back, fd);
+    assert(words_back == words);
+    assert(lseek(fd, 0, SEEK_CUR) == lseek(fd, 0, SEEK_END));
+    close(fd);
+
+    // a pipe cannot be sized up front
+    int pipe_fds[2];
+    assert(pipe(pipe_fds) == 0);
+    jrd::vector<std::uint32_t> small;
+    for (std::uint32_t i = 0; i < 100; ++i) small.push_back(i);
+    jrd::save(small, pipe_fds[1]);
+    jrd::save(words, pipe_fds[1]);
+    close(pipe_fds[1]);
+    jrd::vector<std::uint32_t> small_back;
+    jrd::load(small_back, pipe_fds[0]);
+    jrd::load(words_back, pipe_fds[0]);
+    assert(small_back == small && words_back == words);
+    close(pipe_fds[0]);
+}
+
+int main(){
+    test_fd_raw();
+    test_fd_strings();
+    test_streams();
+    test_corrupted_header();
+    test_fd_records();
+
+    return 0;
+}
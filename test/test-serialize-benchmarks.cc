@@ -0,0 +1,149 @@
+#include "serialize.h"
+#include "vector.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+typedef unsigned long long timestamp_t;
+
+static timestamp_t get_timestamp (){
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+}
+
+static void report(const char * name, timestamp_t t0, timestamp_t t1, std::uint64_t sink){
+    long double secs = static_cast<long double>(t1 - t0) / 1000000.0L;
+    std::cout << name << " took: " << secs << " seconds (" << sink % 10 << ")" << std::endl;
+}
+
+void raw_tests(size_t num_elements);
+void string_tests(size_t num_elements);
+
+int main(){
+    std::cout << "serialize 1000000 uint64" << std::endl;
+    raw_tests(1000000);
+
+    std::cout << "serialize 10000000 uint64" << std::endl;
+    raw_tests(10000000);
+
+    std::cout << "serialize 1000000 strings" << std::endl;
+    string_tests(1000000);
+}
+
+/*
+ * what callers did before jrd::save existed: copy the vector element by
+ * element into a flat buffer and write that. A std::vector written with a
+ * single write() is the floor for the same bytes.
+ */
+void raw_tests(size_t num_elements){
+    const std::string path = "/tmp/jrd-serialize-bench.vec";
+
+    jrd::vector<std::uint64_t> vec;
+    std::vector<std::uint64_t> stdvec(num_elements);
+    for (size_t i = 0; i < num_elements; ++i){
+        vec.push_back(i * 7);
+        stdvec[i] = i * 7;
+    }
+
+    std::uint64_t sink = 0;
+    timestamp_t t0 = get_timestamp();
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        std::vector<std::uint64_t> buf(vec.size());
+        for (size_t i = 0; i < vec.size(); ++i) buf[i] = vec[i];
+        if (write(fd, buf.data(), buf.size() * sizeof(std::uint64_t)) < 0) std::cout << "write failed" << std::endl;
+        close(fd);
+    }
+    timestamp_t t1 = get_timestamp();
+    report("jrd::vector copy + write save       ", t0, t1, sink);
+
+    t0 = get_timestamp();
+    {
+        jrd::vector<std::uint64_t> in;
+        std::vector<std::uint64_t> buf(num_elements);
+        int fd = open(path.c_str(), O_RDONLY);
+        if (read(fd, buf.data(), buf.size() * sizeof(std::uint64_t)) < 0) std::cout << "read failed" << std::endl;
+        close(fd);
+        in.append(buf.data(), buf.size());
+        sink += in.at(in.size() / 2);
+    }
+    t1 = get_timestamp();
+    report("jrd::vector read + append load      ", t0, t1, sink);
+
+    t0 = get_timestamp();
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        jrd::save(vec, fd);
+        close(fd);
+    }
+    t1 = get_timestamp();
+    report("jrd::save writev                    ", t0, t1, sink);
+
+    t0 = get_timestamp();
+    {
+        jrd::vector<std::uint64_t> in;
+        int fd = open(path.c_str(), O_RDONLY);
+        jrd::load(in, fd);
+        close(fd);
+        sink += in.at(in.size() / 2);
+    }
+    t1 = get_timestamp();
+    report("jrd::load readv                     ", t0, t1, sink);
+
+    t0 = get_timestamp();
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (write(fd, stdvec.data(), stdvec.size() * sizeof(std::uint64_t)) < 0) std::cout << "write failed" << std::endl;
+        close(fd);
+    }
+    t1 = get_timestamp();
+    report("std::vector write save              ", t0, t1, sink);
+
+    t0 = get_timestamp();
+    {
+        std::vector<std::uint64_t> in(num_elements);
+        int fd = open(path.c_str(), O_RDONLY);
+        if (read(fd, in.data(), in.size() * sizeof(std::uint64_t)) < 0) std::cout << "read failed" << std::endl;
+        close(fd);
+        sink += in.at(in.size() / 2);
+    }
+    t1 = get_timestamp();
+    report("std::vector read load               ", t0, t1, sink);
+
+    unlink(path.c_str());
+}
+
+void string_tests(size_t num_elements){
+    const std::string path = "/tmp/jrd-serialize-bench.str";
+
+    jrd::vector<std::string> vec;
+    for (size_t i = 0; i < num_elements; ++i) vec.push_back("value-" + std::to_string(i));
+
+    std::uint64_t sink = 0;
+    timestamp_t t0 = get_timestamp();
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        jrd::save(vec, fd);
+        close(fd);
+    }
+    timestamp_t t1 = get_timestamp();
+    report("jrd::save strings                   ", t0, t1, sink);
+
+    t0 = get_timestamp();
+    {
+        jrd::vector<std::string> in;
+        int fd = open(path.c_str(), O_RDONLY);
+        jrd::load(in, fd);
+        close(fd);
+        sink += in[in.size() / 2].size();
+    }
+    t1 = get_timestamp();
+    report("jrd::load strings                   ", t0, t1, sink);
+
+    unlink(path.c_str());
+}
@@ -0,0 +1,173 @@
+#include "soa_vector.h"
+#include "allocator.h"
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+void test_push_and_index(){
+    jrd::soa_vector<uint64_t, double, std::string> vec;
+    assert(vec.empty());
+    for (size_t i = 0; i < 100000; ++i){
+        vec.emplace_back(i, static_cast<double>(i) / 2.0, std::to_string(i));
+    }
+    assert(vec.size() == 100000);
+    assert(vec.capacity() >= vec.size());
+
+    for (size_t i = 0; i < vec.size(); i += 97){
+        auto row = vec[i];
+        assert(std::get<0>(row) == i);
+        assert(std::get<1>(row) == static_cast<double>(i) / 2.0);
+        assert(std::get<2>(row) == std::to_string(i));
+        assert(vec.get<0>(i) == i);
+        assert(vec.get<2>(i) == std::to_string(i));
+    }
+
+    // the row proxy writes through to every column
+    vec[10] = std::make_tuple(uint64_t(7), 1.5, std::string("seven"));
+    assert(vec.get<0>(10) == 7 && vec.get<1>(10) == 1.5 && vec.get<2>(10) == "seven");
+    std::get<1>(vec[11]) = 3.0;
+    assert(vec.get<1>(11) == 3.0);
+    vec.get<0>(12) = 99;
+    assert(std::get<0>(vec[12]) == 99);
+
+    std::tuple<uint64_t, double, std::string> copy = vec[20];
+    std::get<2>(copy) = "changed";
+    assert(vec.get<2>(20) == "20");
+
+    vec.push_back(std::make_tuple(uint64_t(1), 2.0, std::string("three")));
+    assert(vec.size() == 100001);
+    assert(vec.at(100000) == std::make_tuple(uint64_t(1), 2.0, std::string("three")));
+
+    bool thrown = false;
+    try {
+        vec.at(100001);
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    vec.pop_back();
+    assert(vec.size() == 100000);
+    assert(vec.get<2>(vec.size() - 1) == "99999");
+}
+
+void test_columns(){
+    jrd::soa_vector<uint32_t, uint64_t> vec;
+    const jrd::soa_vector<uint32_t, uint64_t> &cvec = vec;
+    assert(cvec.column<1>().size() == 0);
+    for (size_t i = 0; i < 5000; ++i){
+        vec.emplace_back(static_cast<uint32_t>(i), 3 * i);
+    }
+
+    // the segments cover the rows in order, one per block
+    size_t next = 0;
+    size_t sum = 0;
+    for (auto seg : cvec.column<1>()){
+        for (uint64_t v : seg){
+            assert(v == 3 * next);
+            sum += v;
+            ++next;
+        }
+    }
+    assert(next == 5000);
+    assert(sum == 3 * 5000 * 4999 / 2);
+
+    for (auto seg : vec.column<0>()){
+        for (uint32_t &v : seg) v += 1;
+    }
+    assert(vec.get<0>(0) == 1 && vec.get<0>(4999) == 5000);
+    assert(vec.column<0>().size() == vec.column<1>().size());
+}
+
+void test_copy_and_move(){
+    jrd::basic_soa_vector<jrd::doubling_growth<64, 2>, std::allocator<std::tuple<int, std::string>>, int, std::string> vec;
+    for (int i = 0; i < 1000; ++i){
+        vec.emplace_back(i, std::string(static_cast<size_t>(i % 50), 'x'));
+    }
+
+    auto copy = vec;
+    assert(copy.size() == vec.size());
+    copy.get<0>(5) = -1;
+    assert(vec.get<0>(5) == 5);
+    for (size_t i = 0; i < vec.size(); ++i){
+        if (i != 5) assert(copy[i] == vec[i]);
+    }
+
+    auto moved = std::move(copy);
+    assert(moved.size() == 1000 && copy.empty());
+    assert(moved.get<0>(5) == -1);
+
+    copy = moved;
+    assert(copy.size() == 1000);
+    moved.clear();
+    assert(moved.empty() && moved.capacity() == 0);
+    assert(copy.get<1>(999) == std::string(49, 'x'));
+}
+
+struct alignas(64) padded_row {
+    double v[8];
+};
+
+void test_aligned_columns_and_swap(){
+    jrd::soa_vector<char, padded_row> a;
+    jrd::soa_vector<char, padded_row> b;
+    for (int i = 0; i < 100; ++i){
+        a.emplace_back(static_cast<char>('a' + i % 26), padded_row{{static_cast<double>(i)}});
+    }
+    b.emplace_back('z', padded_row{{-1.0}});
+
+    for (auto seg : a.column<1>()){
+        assert(reinterpret_cast<uintptr_t>(seg.data()) % alignof(padded_row) == 0);
+    }
+
+    a.swap(b);
+    assert(a.size() == 1 && b.size() == 100);
+    assert(a.get<0>(0) == 'z' && a.get<1>(0).v[0] == -1.0);
+    for (size_t i = 0; i < b.size(); ++i){
+        assert(b.get<1>(i).v[0] == static_cast<double>(i));
+    }
+    b.swap(a);
+    assert(a.size() == 100 && a.get<0>(99) == 'a' + 99 % 26);
+}
+
+void test_unequal_allocators(){
+    typedef jrd::pool_allocator<std::tuple<int, std::string>> row_allocator;
+    typedef jrd::basic_soa_vector<jrd::doubling_growth<>, row_allocator, int, std::string> pool_soa;
+    jrd::block_pool pool_a;
+    jrd::block_pool pool_b;
+    {
+        pool_soa a{row_allocator(pool_a)};
+        pool_soa b{row_allocator(pool_b)};
+        a.emplace_back(-1, std::string("gone"));
+        for (int i = 0; i < 100; ++i) b.emplace_back(i, std::string(40, static_cast<char>('a' + i % 26)));
+        assert(pool_b.cached_bytes() == 0);
+
+        // the pools differ, the rows move over and b's columns go back to pool_b
+        a = std::move(b);
+        assert(a.get_allocator() == row_allocator(pool_a));
+        assert(b.empty() && pool_b.cached_bytes() > 0);
+        assert(a.size() == 100 && a.get<0>(99) == 99 && a.get<1>(27) == std::string(40, 'b'));
+
+        // copies keep their own pool as well
+        pool_soa c{row_allocator(pool_b)};
+        c = a;
+        assert(c.get_allocator() == row_allocator(pool_b) && c.size() == 100 && c.get<1>(27) == a.get<1>(27));
+
+        // equal allocators hand the columns over
+        pool_soa d{row_allocator(pool_a)};
+        d = std::move(a);
+        assert(a.empty() && d.size() == 100 && d.get<0>(50) == 50);
+    }
+}
+
+int main(){
+    test_push_and_index();
+    test_columns();
+    test_copy_and_move();
+    test_aligned_columns_and_swap();
+    test_unequal_allocators();
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "soa_vector.h"
+#include "vector.h"
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include <sys/time.h>
+
+typedef unsigned long long timestamp_t;
+
+static timestamp_t get_timestamp (){
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+}
+
+// 32 bytes a row, the scans below only read price
+struct record {
+    uint64_t id;
+    double price;
+    uint32_t quantity;
+    uint32_t flags;
+    uint64_t category;
+};
+
+void column_scan(size_t num_iterations, size_t num_append);
+
+int main(){
+    column_scan(50, 1000000);
+    column_scan(10, 10000000);
+}
+
+template <class Scan>
+static void time_scan(const char * name, size_t num_iterations, Scan scan){
+    long double total = 0.0;
+    double sink = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        const timestamp_t t0 = get_timestamp();
+        sink += scan();
+        const timestamp_t t1 = get_timestamp();
+        total += (t1 - t0);
+    }
+    std::cout << name << " took: " << (total / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations (" << sink << ")" << std::endl;
+}
+
+void column_scan(size_t num_iterations, size_t num_append){
+    std::cout << "sum of one double field over " << num_append << " rows" << std::endl;
+    std::vector<record> aos_std;
+    jrd::vector<record> aos;
+    jrd::soa_vector<uint64_t, double, uint32_t, uint32_t, uint64_t> soa;
+    for (size_t i = 0; i < num_append; ++i){
+        const record r{i, static_cast<double>(i % 1000), static_cast<uint32_t>(i), 0, i % 7};
+        aos_std.push_back(r);
+        aos.push_back(r);
+        soa.emplace_back(r.id, r.price, r.quantity, r.flags, r.category);
+    }
+
+    time_scan("std::vector<record>", num_iterations, [&]{
+        double sum = 0.0;
+        for (const record &r : aos_std) sum += r.price;
+        return sum;
+    });
+    time_scan("jrd::vector<record> segments", num_iterations, [&]{
+        double sum = 0.0;
+        for (auto seg : static_cast<const jrd::vector<record> &>(aos).segments()){
+            for (const record &r : seg) sum += r.price;
+        }
+        return sum;
+    });
+    time_scan("jrd::soa_vector column segments", num_iterations, [&]{
+        double sum = 0.0;
+        for (auto seg : soa.column<1>()){
+            for (double v : seg) sum += v;
+        }
+        return sum;
+    });
+    time_scan("jrd::soa_vector get<1>(i)", num_iterations, [&]{
+        double sum = 0.0;
+        for (size_t i = 0; i < soa.size(); ++i) sum += soa.get<1>(i);
+        return sum;
+    });
+    time_scan("jrd::soa_vector row proxy", num_iterations, [&]{
+        double sum = 0.0;
+        for (size_t i = 0; i < soa.size(); ++i) sum += std::get<1>(soa[i]);
+        return sum;
+    });
+}
@@ -0,0 +1,115 @@
+#include "sort.h"
+#include <cassert>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+template <class Vec>
+void check_sort(size_t n, uint64_t range, jrd::thread_pool &pool){
+    std::mt19937_64 gen(n);
+    Vec vec;
+    std::vector<uint64_t> expected;
+    for (size_t i = 0; i < n; ++i){
+        const uint64_t v = gen() % range;
+        vec.push_back(v);
+        expected.push_back(v);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    jrd::sort(vec, std::less<uint64_t>(), pool);
+    assert(vec.size() == n);
+    for (size_t i = 0; i < n; ++i){
+        assert(vec[i] == expected[i]);
+    }
+
+    // already sorted and reversed input
+    jrd::sort(vec, std::greater<uint64_t>(), pool);
+    for (size_t i = 0; i < n; ++i){
+        assert(vec[i] == expected[n - 1 - i]);
+    }
+    jrd::stable_sort(vec, std::less<uint64_t>(), pool);
+    for (size_t i = 0; i < n; ++i){
+        assert(vec[i] == expected[i]);
+    }
+}
+
+void test_sort(){
+    jrd::thread_pool one(1);
+    jrd::thread_pool four(4);
+    for (size_t n : {size_t(0), size_t(1), size_t(2), size_t(17), size_t(1000), size_t(100000), size_t(300001)}){
+        for (jrd::thread_pool *pool : {&one, &four}){
+            check_sort<jrd::vector<uint64_t>>(n, ~uint64_t(0), *pool);
+            check_sort<jrd::vector<uint64_t>>(n, 10, *pool);
+            check_sort<jrd::vector<uint64_t, std::allocator<uint64_t>, jrd::fixed_growth<64>>>(n, 1000, *pool);
+            check_sort<jrd::vector<uint64_t, std::allocator<uint64_t>, jrd::doubling_growth<16, 4>>>(n, ~uint64_t(0), *pool);
+            check_sort<jrd::vector<uint64_t, std::allocator<uint64_t>, jrd::inline_first_block<>>>(n, 100, *pool);
+        }
+    }
+
+    // the std::sort over jrd iterators the benchmark compares against,
+    // an empty vector included
+    for (size_t n : {size_t(0), size_t(1), size_t(5000)}){
+        jrd::vector<uint64_t> a;
+        jrd::vector<uint64_t> b;
+        for (size_t i = 0; i < n; ++i){
+            a.push_back((i * 7919) % 1000);
+            b.push_back((i * 7919) % 1000);
+        }
+        std::sort(a.begin(), a.end());
+        jrd::sort(b, std::less<uint64_t>(), four);
+        assert(a == b);
+    }
+
+    // default comparator and pool
+    jrd::vector<std::string> words;
+    for (size_t i = 0; i < 5000; ++i){
+        words.push_back(std::to_string((i * 7919) % 5000));
+    }
+    jrd::sort(words);
+    assert(std::is_sorted(words.begin(), words.end()));
+}
+
+void test_stable_sort(){
+    jrd::thread_pool four(4);
+    for (size_t n : {size_t(33), size_t(70000), size_t(200000)}){
+        std::mt19937_64 gen(n);
+        // few keys, the second member records the input order
+        jrd::vector<std::pair<uint32_t, size_t>> vec;
+        for (size_t i = 0; i < n; ++i){
+            vec.push_back(std::make_pair(static_cast<uint32_t>(gen() % 16), i));
+        }
+        jrd::stable_sort(vec, [](const std::pair<uint32_t, size_t> &a, const std::pair<uint32_t, size_t> &b){ return a.first < b.first; }, four);
+        for (size_t i = 1; i < n; ++i){
+            assert(vec[i - 1].first < vec[i].first || (vec[i - 1].first == vec[i].first && vec[i - 1].second < vec[i].second));
+        }
+    }
+}
+
+// counts its calls in a plain member, which races unless every task has its own copy
+struct counting_less {
+    size_t calls = 0;
+    bool operator ()(const std::string &a, const std::string &b){ ++calls; return a < b; }
+};
+
+void test_stateful_comparator(){
+    jrd::thread_pool four(4);
+    jrd::vector<std::string> words;
+    for (size_t i = 0; i < 150000; ++i){
+        words.push_back(std::to_string((i * 7919) % 150000));
+    }
+    jrd::vector<std::string> stable_words(words);
+    jrd::sort(words, counting_less(), four);
+    assert(std::is_sorted(words.begin(), words.end()));
+    jrd::stable_sort(stable_words, counting_less(), four);
+    assert(stable_words == words);
+}
+
+int main(){
+    test_sort();
+    test_stable_sort();
+    test_stateful_comparator();
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "sort.h"
+#include <vector>
+#include <random>
+#include <iostream>
+#include <sys/time.h>
+
+typedef unsigned long long timestamp_t;
+
+static timestamp_t get_timestamp (){
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+}
+
+void sort_compare(size_t num_iterations, size_t num_elements);
+
+int main(){
+    std::cout << jrd::thread_pool::default_pool().size() << " threads" << std::endl;
+    sort_compare(5, 1000000);
+    sort_compare(3, 10000000);
+    sort_compare(1, 100000000);
+}
+
+template <class Fill, class Sort>
+static void time_sort(const char * name, size_t num_iterations, Fill fill, Sort sort){
+    long double total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        fill();
+        const timestamp_t t0 = get_timestamp();
+        sort();
+        const timestamp_t t1 = get_timestamp();
+        total += (t1 - t0);
+    }
+    std::cout << name << " took: " << (total / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations" << std::endl;
+}
+
+void sort_compare(size_t num_iterations, size_t num_elements){
+    std::cout << "sort " << num_elements << " random uint64_t" << std::endl;
+    std::vector<uint64_t> input;
+    input.reserve(num_elements);
+    std::mt19937_64 gen(42);
+    for (size_t i = 0; i < num_elements; ++i){
+        input.push_back(gen());
+    }
+
+    {
+        std::vector<uint64_t> vec;
+        auto fill = [&]{ vec = input; };
+        time_sort("std::sort on std::vector", num_iterations, fill, [&]{ std::sort(vec.begin(), vec.end()); });
+        time_sort("std::stable_sort on std::vector", num_iterations, fill, [&]{ std::stable_sort(vec.begin(), vec.end()); });
+    }
+
+    jrd::vector<uint64_t> vec;
+    for (size_t i = 0; i < num_elements; ++i){
+        vec.push_back(0);
+    }
+    auto fill = [&]{
+        size_t i = 0;
+        for (auto seg : vec.segments()){
+            std::copy(input.begin() + static_cast<ptrdiff_t>(i), input.begin() + static_cast<ptrdiff_t>(i + seg.size()), seg.data());
+            i += seg.size();
+        }
+    };
+    time_sort("std::sort on jrd::vector iterators", num_iterations, fill, [&]{ std::sort(vec.begin(), vec.end()); });
+    time_sort("jrd::sort", num_iterations, fill, [&]{ jrd::sort(vec); });
+    time_sort("jrd::stable_sort", num_iterations, fill, [&]{ jrd::stable_sort(vec); });
+}
@@ -2,6 +2,15 @@
 #include <cassert>
 #include <string>
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <utility>
 
 void test_push_back(){
     jrd::vector<size_t> veci;
@@ -41,10 +50,830 @@ void test_indexing(){
     assert(vecs.size() == 10000);
 }
 
+void test_at(){
+    jrd::vector<size_t> veci;
+    bool thrown = false;
+    try { veci.at(0); } catch (const std::out_of_range &) { thrown = true; }
+    assert(thrown);
+
+    for (size_t i = 0; i < 5000; ++i){
+        veci.push_back(i);
+    }
+
+    for (size_t i = 0; i < 5000; ++i){
+        assert(veci.at(i) == i);
+        assert(&veci.at(i) == &veci[i]);
+    }
+
+    // neighbours across every block boundary must be distinct slots
+    for (size_t i = 1; i < 5000; ++i){
+        assert(&veci[i] != &veci[i - 1]);
+    }
+
+    thrown = false;
+    try { veci.at(5000); } catch (const std::out_of_range &) { thrown = true; }
+    assert(thrown);
+}
+
+void test_iterators(){
+    jrd::vector<size_t> empty;
+    assert(empty.begin() == empty.end());
+    assert(empty.end() - empty.begin() == 0);
+    assert(empty.cbegin().index() == 0 && jrd::vector<size_t>::iterator().index() == 0);
+    std::sort(empty.begin(), empty.end());
+
+    jrd::vector<size_t> veci;
+    for (size_t i = 0; i < 100000; ++i){
+        veci.push_back(i);
+    }
+
+    size_t expected = 0;
+    for (auto v : veci){
+        assert(v == expected);
+        ++expected;
+    }
+    assert(expected == 100000);
+    assert(static_cast<size_t>(veci.end() - veci.begin()) == veci.size());
+
+    // tail block exactly full: end() must still be reachable with ++
+    jrd::vector<size_t> full;
+    for (size_t i = 0; i < 48; ++i){
+        full.push_back(i);
+    }
+    assert(static_cast<size_t>(std::distance(full.begin(), full.end())) == 48);
+
+    auto it = veci.begin();
+    for (size_t i = 0; i < 100000; i += 997){
+        assert(it[static_cast<ptrdiff_t>(i)] == i);
+        assert(*(veci.begin() + static_cast<ptrdiff_t>(i)) == i);
+        assert(*(veci.end() - static_cast<ptrdiff_t>(100000 - i)) == i);
+    }
+
+    size_t back = 100000;
+    for (auto rit = veci.rbegin(); rit != veci.rend(); ++rit){
+        assert(*rit == --back);
+    }
+    assert(back == 0);
+
+    const jrd::vector<size_t> & cref = veci;
+    assert(std::accumulate(cref.begin(), cref.end(), size_t(0)) == 100000ull * 99999ull / 2);
+    assert(std::find(veci.begin(), veci.end(), 4242) - veci.begin() == 4242);
+
+    std::fill(veci.begin(), veci.end(), 7);
+    assert(std::count(veci.cbegin(), veci.cend(), 7) == 100000);
+
+    jrd::vector<size_t> copy(full.begin(), full.end());
+    assert(copy.size() == 48);
+    assert(copy[47] == 47);
+}
+
+void test_segments(){
+    jrd::vector<size_t> veci;
+    assert(veci.segments().size() == 0);
+
+    for (size_t i = 0; i < 1000; ++i){
+        veci.push_back(i);
+    }
+
+    size_t expected = 0;
+    for (auto seg : veci.segments()){
+        assert(!seg.empty());
+        for (auto v : seg){
+            assert(v == expected);
+            ++expected;
+        }
+    }
+    assert(expected == 1000);
+
+    size_t total = 0;
+    veci.for_each_segment([&](jrd::vector<size_t>::segment seg){
+        for (size_t i = 0; i < seg.size(); ++i){
+            seg.data()[i] *= 2;
+        }
+        total += seg.size();
+    });
+    assert(total == 1000);
+
+    const jrd::vector<size_t> & cref = veci;
+    size_t sum = 0;
+    cref.for_each_segment([&](jrd::vector<size_t>::const_segment seg){
+        sum = std::accumulate(seg.begin(), seg.end(), sum);
+    });
+    assert(sum == 1000ull * 999ull);
+}
+
+void test_clear(){
+    jrd::vector<std::string> vecs;
+    for (size_t round = 0; round < 3; ++round){
+        for (size_t i = 0; i < 1000; ++i){
+            vecs.push_back(std::to_string(i));
+        }
+        assert(vecs.size() == 1000);
+        assert(vecs.capacity() >= 1000);
+        assert(vecs[999] == "999");
+        vecs.clear();
+        assert(vecs.empty());
+        assert(vecs.begin() == vecs.end());
+    }
+}
+
+// counts live objects, has no default constructor
+struct tracked {
+    static long live;
+    static long copies;
+    size_t value;
+
+    explicit tracked(size_t v) : value(v) { ++live; }
+    tracked(const tracked & other) : value(other.value) { ++live; ++copies; }
+    tracked(tracked && other) noexcept : value(other.value) { ++live; }
+    tracked & operator = (const tracked &) = default;
+    ~tracked() { --live; }
+};
+
+long tracked::live = 0;
+long tracked::copies = 0;
+
+void test_in_place(){
+    {
+        jrd::vector<tracked> vec;
+        // no slot is constructed before something is appended
+        assert(tracked::live == 0);
+        for (size_t i = 0; i < 1000; ++i){
+            vec.emplace_back(i);
+        }
+        assert(tracked::live == 1000);
+        for (size_t i = 0; i < 1000; ++i){
+            vec.push_back(tracked(i));
+        }
+        assert(tracked::live == 2000);
+        assert(tracked::copies == 0);
+        assert(vec[1500].value == 500);
+
+        vec.clear();
+        assert(tracked::live == 0);
+        vec.emplace_back(7);
+        assert(tracked::live == 1);
+    }
+    assert(tracked::live == 0);
+
+    jrd::vector<std::string> vecs;
+    std::string word = "moved away";
+    vecs.push_back(std::move(word));
+    assert(vecs[0] == "moved away");
+}
+
+// throws from its constructor once armed
+struct fragile {
+    static bool armed;
+    size_t value;
+
+    fragile() : value(0) { if (armed) throw std::runtime_error("fragile"); }
+    explicit fragile(size_t v) : value(v) { if (armed) throw std::runtime_error("fragile"); }
+    fragile(const fragile & other) : value(other.value) { if (armed) throw std::runtime_error("fragile"); }
+};
+
+bool fragile::armed = false;
+
+void test_throw_at_block_boundary(){
+    jrd::vector<fragile> vec;
+    for (size_t i = 0; i < 16; ++i){
+        vec.emplace_back(i);
+    }
+
+    // the 17th element opens block 1 and fails, the vector must not change
+    fragile::armed = true;
+    bool thrown = false;
+    try { vec.emplace_back(16); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+    assert(vec.size() == 16);
+    assert(vec.back().value == 15);
+    size_t seen = 0;
+    for (auto seg : vec.segments()) seen += seg.size();
+    assert(seen == 16);
+    assert(vec.end() - vec.begin() == 16);
+
+    // the same through append and grow_by
+    std::vector<fragile> more;
+    fragile::armed = false;
+    more.emplace_back(100);
+    fragile::armed = true;
+    thrown = false;
+    try { vec.append(more.begin(), more.end()); } catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown && vec.size() == 16 && vec.back().value == 15);
+
+    // the block opened for the failed element is reused
+    fragile::armed = false;
+    for (size_t i = 16; i < 40; ++i){
+        vec.emplace_back(i);
+    }
+    assert(vec.size() == 40);
+    for (size_t i = 0; i < 40; ++i){
+        assert(vec[i].value == i);
+    }
+
+    // grow_by at the next boundary, 16 + 16 + 32 = 64
+    for (size_t i = 40; i < 64; ++i){
+        vec.emplace_back(i);
+    }
+    fragile::armed = true;
+    thrown = false;
+    try { vec.grow_by(10); } catch (const std::runtime_error &) { thrown = true; }
+    fragile::armed = false;
+    assert(thrown && vec.size() == 64 && vec.back().value == 63);
+    vec.grow_by(1);
+    assert(vec.size() == 65 && vec[64].value == 0 && vec[63].value == 63);
+}
+
+void test_append(){
+    std::vector<size_t> src(1000);
+    std::iota(src.begin(), src.end(), 0);
+
+    jrd::vector<size_t> veci;
+    veci.push_back(42);
+    veci.append(src.data(), src.size());
+    veci.append(src.begin(), src.end());
+    assert(veci.size() == 2001);
+    assert(veci[0] == 42);
+    for (size_t i = 0; i < 1000; ++i){
+        assert(veci[1 + i] == i);
+        assert(veci[1001 + i] == i);
+    }
+
+    std::list<std::string> words{"a", "b", "c"};
+    jrd::vector<std::string> vecs(words.begin(), words.end());
+    vecs.append(words.begin(), words.end());
+    assert(vecs.size() == 6);
+    assert(vecs[3] == "a" && vecs[5] == "c");
+
+    std::istringstream in("1 2 3 4");
+    jrd::vector<size_t> from_stream{std::istream_iterator<size_t>(in), std::istream_iterator<size_t>()};
+    assert(from_stream.size() == 4 && from_stream[3] == 4);
+}
+
+void test_grow_by(){
+    jrd::vector<size_t> veci;
+    veci.push_back(0);
+
+    // the new elements span several blocks, the first segment starts mid block
+    size_t next = 1;
+    size_t num_segs = 0;
+    for (auto seg : veci.grow_by(100)){
+        for (auto &v : seg) v = next++;
+        ++num_segs;
+    }
+    assert(next == 101);
+    assert(num_segs == 4);
+    assert(veci.size() == 101);
+    for (size_t i = 0; i < 101; ++i){
+        assert(veci[i] == i);
+    }
+
+    jrd::vector<std::string> vecs;
+    auto segs = vecs.grow_by(20);
+    assert(segs.size() == 2);
+    assert(segs[0].size() == 16 && segs[1].size() == 4);
+    assert(vecs[19].empty());
+    assert(vecs.grow_by(0).size() == 0);
+}
+
+// std::allocator that counts the calls to allocate
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+    typedef T value_type;
+    template <typename U> struct rebind { typedef counting_allocator<U> other; };
+
+    static size_t calls;
+
+    counting_allocator() noexcept {}
+    template <typename U>
+    counting_allocator(const counting_allocator<U> &) noexcept {}
+
+    T * allocate(size_t n) {
+        ++calls;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+template <typename T>
+size_t counting_allocator<T>::calls = 0;
+
+void test_reserve(){
+    jrd::vector<size_t, counting_allocator<size_t>> veci;
+    assert(veci.capacity() == 0);
+
+    veci.reserve(1000000);
+    assert(veci.capacity() >= 1000000);
+    assert(veci.capacity() < 2 * 1000000);
+    const size_t cap = veci.capacity();
+    const size_t calls = counting_allocator<size_t>::calls;
+
+    // reserving less than the capacity is a no-op
+    veci.reserve(10);
+    assert(veci.capacity() == cap);
+
+    for (size_t i = 0; i < 1000000; ++i){
+        veci.push_back(i);
+    }
+    assert(counting_allocator<size_t>::calls == calls);
+    assert(veci.capacity() == cap);
+    for (size_t i = 0; i < 1000000; i += 997){
+        assert(veci[i] == i);
+    }
+    assert(std::distance(veci.begin(), veci.end()) == 1000000);
+
+    // the reserved blocks are released along with the used ones
+    jrd::vector<std::string> vecs;
+    vecs.push_back("a");
+    vecs.reserve(5000, true);
+    assert(vecs.capacity() >= 5000);
+    assert(vecs.size() == 1);
+    assert(vecs.segments().size() == 1);
+    vecs.clear();
+    assert(vecs.capacity() == 0);
+    vecs.push_back("b");
+    assert(vecs[0] == "b");
+}
+
+template <class Policy>
+void check_policy(size_t n){
+    jrd::vector<size_t, std::allocator<size_t>, Policy> vec;
+    for (size_t i = 0; i < n; ++i){
+        vec.push_back(i);
+    }
+    assert(vec.size() == n);
+    for (size_t i = 0; i < n; ++i){
+        assert(vec[i] == i);
+    }
+
+    // the segments tile the vector in order with the policy's block sizes
+    size_t expect = 0;
+    size_t b = 0;
+    for (auto seg : vec.segments()){
+        assert(seg.size() == std::min(Policy::block_size(b), n - Policy::block_start(b)));
+        for (size_t v : seg) assert(v == expect++);
+        ++b;
+    }
+    assert(expect == n);
+
+    size_t i = 0;
+    for (auto it = vec.begin(); it != vec.end(); ++it, ++i){
+        assert(*it == i);
+        assert(it.index() == i);
+    }
+    assert(i == n);
+    assert((vec.end() - 1).index() == n - 1);
+
+    vec.reserve(4 * n);
+    assert(vec.capacity() >= 4 * n);
+    vec.append(vec.begin(), vec.end());
+    assert(vec.size() == 2 * n && vec[2 * n - 1] == n - 1);
+    vec.clear();
+    vec.push_back(3);
+    assert(vec[0] == 3);
+}
+
+void test_policies(){
+    check_policy<jrd::doubling_growth<>>(100000);
+    check_policy<jrd::doubling_growth<4096>>(100000);
+    check_policy<jrd::doubling_growth<16, 2>>(100000);
+    check_policy<jrd::doubling_growth<16, 4>>(100000);
+    check_policy<jrd::doubling_growth<2, 2>>(10000);
+    check_policy<jrd::fixed_growth<64>>(100000);
+    check_policy<jrd::fixed_growth<4096>>(100000);
+
+    // four blocks per doubling, growth of about 1.19 per block
+    typedef jrd::doubling_growth<16, 4> quarter;
+    assert(quarter::block_size(0) == 4 && quarter::block_size(7) == 4);
+    assert(quarter::block_size(8) == 8 && quarter::block_start(8) == 32);
+    assert(quarter::block_size(12) == 16 && quarter::block_start(12) == 64);
+
+    jrd::vector<std::string, std::allocator<std::string>, jrd::fixed_growth<8>> vecs;
+    for (size_t i = 0; i < 1000; ++i){
+        vecs.emplace_back(std::to_string(i));
+    }
+    assert(vecs.capacity() == 1000);
+    assert(vecs[999] == "999");
+}
+
+void test_lazy_and_inline(){
+    counting_allocator<size_t>::calls = 0;
+    {
+        // an empty vector owns no memory
+        jrd::vector<size_t, counting_allocator<size_t>> empty;
+        assert(empty.capacity() == 0);
+        assert(empty.begin() == empty.end());
+        assert(empty.segments().size() == 0);
+    }
+    assert(counting_allocator<size_t>::calls == 0);
+
+    typedef jrd::vector<size_t, counting_allocator<size_t>, jrd::inline_first_block<>> small_vector;
+    {
+        small_vector vec;
+        assert(vec.capacity() == 0);
+        for (size_t i = 0; i < 16; ++i){
+            vec.push_back(i);
+        }
+        // the first 16 elements live inside the object
+        const char * obj = reinterpret_cast<const char *>(&vec);
+        const char * elem = reinterpret_cast<const char *>(&vec[0]);
+        assert(elem >= obj && elem < obj + sizeof(vec));
+        assert(counting_allocator<size_t>::calls == 0);
+
+        vec.push_back(16);
+        assert(counting_allocator<size_t>::calls == 1);
+        for (size_t i = 0; i < 17; ++i){
+            assert(vec[i] == i);
+        }
+        vec.clear();
+        vec.push_back(7);
+        assert(vec[0] == 7);
+        assert(counting_allocator<size_t>::calls == 1);
+    }
+
+    {
+        jrd::vector<tracked, std::allocator<tracked>, jrd::inline_first_block<jrd::doubling_growth<4>>> vec;
+        for (size_t i = 0; i < 100; ++i){
+            vec.emplace_back(i);
+        }
+        assert(tracked::live == 100);
+        assert(vec[99].value == 99);
+        vec.reserve(1000);
+        assert(tracked::live == 100);
+    }
+    assert(tracked::live == 0);
+}
+
+void test_copy_on_write(){
+    // the share counts live beside the directory, a slot is one pointer
+    static_assert(sizeof(jrd::vector<size_t>) < jrd::doubling_growth<>::max_blocks * sizeof(size_t *) + 16 * sizeof(size_t),
+                  "the inline directory holds one pointer per block");
+
+    jrd::vector<size_t> orig;
+    for (size_t i = 0; i < 1000; ++i){
+        orig.push_back(i);
+    }
+    const auto & corig = orig;
+
+    // every block is shared, the partly filled tail too
+    jrd::vector<size_t> copy(orig);
+    const auto & ccopy = copy;
+    assert(copy == orig);
+    assert(&ccopy[0] == &corig[0]);
+    assert(&ccopy[500] == &corig[500]);
+    assert(&ccopy[999] == &corig[999]);
+
+    // the source appends into the shared tail, the copy clones it first
+    orig.push_back(1000);
+    assert(&ccopy[999] == &corig[999]);
+    copy.push_back(7);
+    assert(&ccopy[999] != &corig[999]);
+    assert(corig[1000] == 1000 && ccopy[1000] == 7);
+    assert(orig != copy);
+
+    // a write clones only the block it lands in
+    copy[500] = 12345;
+    assert(corig[500] == 500 && ccopy[500] == 12345);
+    assert(&ccopy[500] != &corig[500]);
+    assert(&ccopy[0] == &corig[0]);
+
+    // more blocks than the share table starts with
+    jrd::vector<size_t, std::allocator<size_t>, jrd::fixed_growth<16>> many;
+    many.grow_by(1000);
+    for (size_t i = 0; i < many.size(); ++i) many[i] = i;
+    auto many_copy = many;
+    const auto & cmany = many;
+    const auto & cmany_copy = many_copy;
+    assert(&cmany_copy[900] == &cmany[900]);
+    many_copy[900] = 0;
+    many.push_back(1000);
+    assert(cmany[900] == 900 && cmany_copy[900] == 0 && &cmany_copy[0] == &cmany[0]);
+    assert(many.size() == 1001 && many_copy.size() == 1000);
+
+    // once the copy is gone the source takes its blocks back without cloning
+    const size_t * first = &corig[0];
+    {
+        jrd::vector<size_t> snap = orig.snapshot();
+        assert(snap.size() == 1001);
+    }
+    copy = jrd::vector<size_t>();
+    orig[0] = 99;
+    assert(&corig[0] == first);
+    for (auto &v : orig) v += 1;
+    assert(orig[0] == 100 && orig[1000] == 1001);
+
+    // copy assignment, self assignment, moves
+    jrd::vector<size_t> other;
+    other.push_back(5);
+    other = orig;
+    assert(other == orig);
+    other = other;
+    assert(other == orig);
+    jrd::vector<size_t> moved(std::move(other));
+    assert(moved == orig && other.empty());
+    other = std::move(moved);
+    assert(other == orig && moved.empty());
+    moved.push_back(1);
+    assert(moved.size() == 1 && moved[0] == 1);
+
+    // every element is built and destroyed once, whoever lets go last
+    tracked::copies = 0;
+    {
+        jrd::vector<tracked> vec;
+        for (size_t i = 0; i < 100; ++i){
+            vec.emplace_back(i);
+        }
+        jrd::vector<tracked> vec2(vec);
+        assert(tracked::live == 100 && tracked::copies == 0);
+        vec2[3].value = 42;
+        assert(vec[3].value == 3 && vec2[3].value == 42);
+        assert(tracked::live == 116 && tracked::copies == 16);
+
+        // the source appends past the copies, then goes away first
+        jrd::vector<tracked> vec3(vec);
+        for (size_t i = 100; i < 120; ++i){
+            vec.emplace_back(i);
+        }
+        jrd::vector<tracked> vec4(vec);
+        vec.clear();
+        assert(vec3.size() == 100 && vec4.size() == 120 && vec4[119].value == 119);
+        vec4.clear();
+        assert(tracked::live == 136);
+        assert(vec2[63].value == 63 && vec2[99].value == 99);
+        vec2.clear();
+        assert(tracked::live == 120);
+
+        // the tail comes back to vec3 with the extra elements destroyed
+        vec3[99].value = 7;
+        assert(tracked::live == 100);
+        vec3.emplace_back(100);
+        assert(tracked::live == 101 && vec3[99].value == 7 && vec3[100].value == 100);
+    }
+    assert(tracked::live == 0);
+
+    {
+        jrd::vector<tracked, std::allocator<tracked>, jrd::inline_first_block<>> vec;
+        for (size_t i = 0; i < 40; ++i){
+            vec.emplace_back(i);
+        }
+        jrd::vector<tracked, std::allocator<tracked>, jrd::inline_first_block<>> vec2(vec);
+        jrd::vector<tracked, std::allocator<tracked>, jrd::inline_first_block<>> vec3(std::move(vec));
+        assert(vec.empty());
+        for (size_t i = 0; i < 40; ++i){
+            assert(vec2[i].value == i && vec3[i].value == i);
+        }
+    }
+    assert(tracked::live == 0);
+
+    jrd::vector<std::string, std::allocator<std::string>, jrd::fixed_growth<8>> words;
+    for (size_t i = 0; i < 100; ++i){
+        words.push_back(std::to_string(i));
+    }
+    auto words2 = words.snapshot();
+    words[10] = "ten";
+    assert(words2[10] == "10" && words[10] == "ten");
+    assert(words2 != words);
+
+    // a reporter thread reads a snapshot while the owner keeps writing
+    jrd::vector<size_t> live;
+    for (size_t i = 0; i < 100000; ++i){
+        live.push_back(1);
+    }
+    jrd::vector<size_t> snap = live.snapshot();
+    size_t seen = 0;
+    std::thread reporter([&](){
+        const auto & csnap = snap;
+        for (size_t r = 0; r < 10; ++r){
+            seen = std::accumulate(csnap.begin(), csnap.end(), size_t(0));
+            if (seen != 100000) return;
+        }
+    });
+    for (size_t r = 0; r < 10; ++r){
+        for (auto &v : live) v += 1;
+        live.push_back(1);
+    }
+    reporter.join();
+    assert(seen == 100000);
+    assert(live[0] == 11 && live.size() == 100010);
+}
+
+void test_pop_back(){
+    counting_allocator<size_t>::calls = 0;
+    jrd::vector<size_t, counting_allocator<size_t>> vec;
+    bool thrown = false;
+    try { vec.pop_back(); } catch (const std::out_of_range &) { thrown = true; }
+    assert(thrown);
+
+    for (size_t i = 0; i < 64; ++i){
+        vec.push_back(i);
+    }
+    assert(vec.back() == 63 && vec.capacity() == 64);
+    const size_t calls = counting_allocator<size_t>::calls;
+
+    // the emptied tail block stays as the one spare
+    for (size_t i = 64; i > 32; --i){
+        assert(vec.back() == i - 1);
+        vec.pop_back();
+    }
+    assert(vec.size() == 32 && vec.back() == 31 && vec.capacity() == 64);
+
+    // going back and forth across the boundary allocates nothing
+    for (size_t r = 0; r < 1000; ++r){
+        vec.push_back(32);
+        vec.pop_back();
+    }
+    assert(counting_allocator<size_t>::calls == calls);
+
+    // the next block to run empty becomes the spare, the old spare is freed
+    for (size_t i = 32; i > 16; --i){
+        vec.pop_back();
+    }
+    assert(vec.capacity() == 32);
+    for (size_t i = 16; i > 0; --i){
+        vec.pop_back();
+    }
+    assert(vec.empty() && vec.capacity() == 16);
+    vec.shrink_to_fit();
+    assert(vec.capacity() == 0);
+
+    for (size_t i = 0; i < 100; ++i){
+        vec.push_back(i);
+    }
+    vec.reserve(10000);
+    vec.shrink_to_fit();
+    assert(vec.capacity() == 128);
+    assert(vec.size() == 100 && vec.back() == 99 && vec[50] == 50);
+    const auto & cvec = vec;
+    assert(cvec.back() == 99);
+
+    {
+        jrd::vector<tracked, std::allocator<tracked>, jrd::inline_first_block<>> objs;
+        for (size_t i = 0; i < 40; ++i){
+            objs.emplace_back(i);
+        }
+        while (objs.size() > 10) objs.pop_back();
+        assert(tracked::live == 10 && objs.back().value == 9);
+        objs.emplace_back(10);
+        assert(objs[10].value == 10);
+        objs.shrink_to_fit();
+        assert(tracked::live == 11 && objs.capacity() == 16);
+    }
+    assert(tracked::live == 0);
+
+    // popping from a copy leaves the source alone
+    jrd::vector<std::string> words;
+    for (size_t i = 0; i < 40; ++i){
+        words.push_back(std::to_string(i));
+    }
+    jrd::vector<std::string> copy(words);
+    while (copy.size() > 5) copy.pop_back();
+    copy.back() = "four";
+    copy.push_back("five");
+    assert(words.size() == 40 && words[39] == "39" && words[4] == "4" && words[5] == "5");
+    assert(copy.size() == 6 && copy[4] == "four" && copy[5] == "five");
+    words.pop_back();
+    assert(words.back() == "38");
+
+    // a failed append at a block boundary leaves nothing for back() and
+    // pop_back() to trip over, down to empty
+    jrd::vector<fragile> frail;
+    for (size_t i = 0; i < 16; ++i){
+        frail.emplace_back(i);
+    }
+    fragile::armed = true;
+    thrown = false;
+    try { frail.emplace_back(16); } catch (const std::runtime_error &) { thrown = true; }
+    fragile::armed = false;
+    assert(thrown);
+    for (size_t i = 16; i > 0; --i){
+        assert(frail.back().value == i - 1 && frail.front().value == 0);
+        frail.pop_back();
+    }
+    assert(frail.empty());
+    thrown = false;
+    try { frail.back(); } catch (const std::out_of_range &) { thrown = true; }
+    assert(thrown);
+}
+
+void test_memory_stats(){
+    typedef jrd::vector<size_t, std::allocator<size_t>, jrd::with_memory_stats<>> tracked_vector;
+    static_assert(sizeof(tracked_vector) == sizeof(jrd::vector<size_t>) + 3 * sizeof(size_t), "the counters are the only extra state");
+
+    tracked_vector vec;
+    jrd::memory_stats st = vec.memory();
+    assert(st.bytes_allocated == 0 && st.bytes_live == 0 && st.allocations == 0 && st.peak_bytes == 0);
+
+    for (size_t i = 0; i < 17; ++i){
+        vec.push_back(i);
+    }
+    st = vec.memory();
+    assert(st.num_blocks == 2 && st.num_allocated == 2 && st.allocations == 2);
+    assert(st.bytes_allocated == 32 * sizeof(size_t) && st.bytes_live == 17 * sizeof(size_t));
+    assert(st.tail_slack == 15 * sizeof(size_t) && st.spare_bytes == 0);
+
+    // the emptied block stays as a spare until shrink_to_fit
+    vec.pop_back();
+    st = vec.memory();
+    assert(st.num_blocks == 1 && st.num_allocated == 2 && st.spare_bytes == 16 * sizeof(size_t) && st.tail_slack == 0);
+    vec.shrink_to_fit();
+    st = vec.memory();
+    assert(st.bytes_allocated == 16 * sizeof(size_t) && st.deallocations == 1 && st.peak_bytes == 32 * sizeof(size_t));
+
+    // a copy holds the same blocks without allocating, until it writes
+    tracked_vector copy(vec);
+    st = copy.memory();
+    assert(st.allocations == 0 && st.bytes_allocated == 16 * sizeof(size_t) && st.peak_bytes == st.bytes_allocated);
+    copy[0] = 100;
+    assert(copy.memory().allocations == 1 && vec.memory().allocations == 2);
+
+    // a moved from vector hands its counts over
+    tracked_vector moved(std::move(vec));
+    assert(moved.memory().allocations == 2 && vec.memory().allocations == 0);
+
+    // the heap directory of an unbounded policy is part of the footprint
+    jrd::vector<size_t, std::allocator<size_t>, jrd::with_memory_stats<jrd::fixed_growth<64>>> fixed;
+    fixed.push_back(1);
+    st = fixed.memory();
+    assert(st.bytes_allocated > 64 * sizeof(size_t) && st.tail_slack == 63 * sizeof(size_t));
+
+    // the inline block is not heap memory
+    jrd::vector<size_t, std::allocator<size_t>, jrd::with_memory_stats<jrd::inline_first_block<>>> small;
+    for (size_t i = 0; i < 20; ++i){
+        small.push_back(i);
+    }
+    st = small.memory();
+    assert(st.allocations == 1 && st.bytes_allocated == 16 * sizeof(size_t));
+}
+
+void test_gather_scatter(){
+    jrd::vector<size_t> vec;
+    for (size_t i = 0; i < 100000; ++i){
+        vec.push_back(3 * i);
+    }
+
+    std::vector<size_t> idx;
+    for (size_t i = 0; i < 1000; ++i){
+        idx.push_back((i * 7919) % vec.size());
+    }
+    std::vector<size_t> out(idx.size());
+    vec.gather(idx.data(), idx.size(), out.data());
+    for (size_t k = 0; k < idx.size(); ++k){
+        assert(out[k] == 3 * idx[k]);
+    }
+
+    // fewer indices than the prefetch distance
+    vec.gather(idx.data(), 3, out.data());
+    assert(out[2] == 3 * idx[2]);
+    vec.gather(idx.data(), 0, nullptr);
+
+    // a copy still sharing the blocks keeps its values
+    jrd::vector<size_t> copy(vec);
+    std::vector<size_t> values(idx.size());
+    for (size_t k = 0; k < values.size(); ++k){
+        values[k] = k;
+    }
+    vec.scatter(idx.data(), idx.size(), values.data());
+    for (size_t k = 0; k < idx.size(); ++k){
+        assert(vec[idx[k]] == k);
+        assert(copy[idx[k]] == 3 * idx[k]);
+    }
+
+    // the later of two writes to one index wins
+    const size_t twice[2] = {5, 5};
+    const size_t vals[2] = {1, 2};
+    vec.scatter(twice, 2, vals);
+    assert(vec[5] == 2);
+
+    jrd::vector<std::string, std::allocator<std::string>, jrd::fixed_growth<64>> words;
+    for (size_t i = 0; i < 500; ++i){
+        words.push_back(std::to_string(i));
+    }
+    std::vector<std::string> got(idx.size());
+    for (size_t &j : idx) j %= words.size();
+    words.gather(idx.data(), idx.size(), got.data());
+    for (size_t k = 0; k < idx.size(); ++k){
+        assert(got[k] == std::to_string(idx[k]));
+    }
+}
+
 int main(){
 
     test_push_back();
     test_indexing();
+    test_at();
+    test_iterators();
+    test_segments();
+    test_clear();
+    test_in_place();
+    test_throw_at_block_boundary();
+    test_append();
+    test_grow_by();
+    test_reserve();
+    test_policies();
+    test_lazy_and_inline();
+    test_copy_on_write();
+    test_pop_back();
+    test_memory_stats();
+    test_gather_scatter();
 
 
     return 0;
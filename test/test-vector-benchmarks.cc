@@ -1,50 +1,115 @@
 #include "vector.h"
+#include "bench.h"
+#include "perf_counters.h"
 #include <string>
 #include <vector>
 #include <iostream>
 #include <deque>
 #include <random>
 #include <cassert>
-#include <sys/time.h>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
 
 typedef unsigned long long timestamp_t;
 
+// microseconds on the monotonic clock, bench-vector has the full harness
 static timestamp_t get_timestamp (){
-    struct timeval now;
-    gettimeofday (&now, NULL);
-    return  static_cast<long long unsigned int>(now.tv_usec) + static_cast<timestamp_t>(now.tv_sec) * 1000000;
+    return static_cast<timestamp_t>(jrd::bench::now_ns() / 1000.0);
+}
+
+// set from main when JRD_PERF is in the environment and the counters open
+static jrd::bench::perf_counters * counters = nullptr;
+
+static void counters_start(){
+    if (counters != nullptr) counters->start();
+}
+
+static void counters_stop(){
+    if (counters != nullptr) counters->stop();
+}
+
+// per operation averages of whatever was counted since the last report
+static void report_counters(const char * name, size_t ops){
+    if (counters == nullptr) return;
+    std::cout << name << " per op:";
+    for (size_t e = 0; e < jrd::bench::perf_counters::num_events; ++e){
+        const auto ev = static_cast<jrd::bench::perf_counters::event>(e);
+        if (counters->has(ev)) std::cout << " " << jrd::bench::perf_counters::name(ev) << " " << counters->total(ev) / static_cast<double>(ops);
+    }
+    std::cout << std::endl;
+    counters->reset();
 }
 
 void test_runner(size_t num_iterations, size_t num_append);
 void random_access(size_t num_iterations, size_t num_append);
 void seq_access(size_t num_iterations, size_t num_append);
 void iter_access(size_t num_iterations, size_t num_append);
+void random_gap(size_t num_iterations, size_t num_append);
+void segment_access(size_t num_iterations, size_t num_append);
+void batch_append(size_t num_iterations, size_t num_append, size_t batch);
+void reserved_ingest(size_t num_iterations, size_t num_append);
+void policy_runner(size_t num_iterations, size_t num_append);
+void small_vectors(size_t num_vectors, size_t num_append);
+void snapshot_copy(size_t num_iterations, size_t num_append);
+void oscillation(size_t num_iterations, size_t base, size_t burst, size_t cycles);
+void gather_access(size_t num_iterations, size_t num_append);
 
 
 void jrd_vec_size_t(size_t num_iterations, jrd::vector<size_t> & vec);
 void jrd_vec_str(size_t num_iterations, jrd::vector<std::string> & vec);
-void jrd_vec_random(size_t num_iterations, jrd::vector<size_t> & vec);
+void jrd_vec_random(const std::vector<size_t> & idx, jrd::vector<size_t> & vec);
 void jrd_vec_seq(size_t num_iterations, jrd::vector<size_t> & vec);
 void jrd_vec_iter(size_t num_iterations, jrd::vector<size_t> & vec);
 
 void std_vec_size_t(size_t num_iterations, std::vector<size_t> & vec);
 void std_vec_str(size_t num_iterations, std::vector<std::string> & vec);
-void std_vec_random(size_t num_iterations, std::vector<size_t> & vec);
+void std_vec_random(const std::vector<size_t> & idx, std::vector<size_t> & vec);
 void std_vec_seq(size_t num_iterations, std::vector<size_t> & vec);
 void std_vec_iter(size_t num_iterations, std::vector<size_t> & vec);
 
+void jrd_vec_segment(size_t num_iterations, jrd::vector<size_t> & vec);
+void std_vec_segment(size_t num_iterations, std::vector<size_t> & vec);
+
+size_t jrd_vec_gather(const std::vector<size_t> & idx, const jrd::vector<size_t> & vec);
+size_t std_vec_gather(const std::vector<size_t> & idx, const std::vector<size_t> & vec);
+size_t jrd_vec_chase(const std::vector<size_t> & idx, const jrd::vector<size_t> & vec);
+size_t std_vec_chase(const std::vector<size_t> & idx, const std::vector<size_t> & vec);
+
 
 void push_back_tests();
 void random_access_tests();
 void seq_access_tests();
 void iter_access_tests();
+void random_gap_tests();
+void segment_access_tests();
+void batch_append_tests();
+void reserve_tests();
+void policy_tests();
+void small_vector_tests();
+void snapshot_tests();
+void oscillation_tests();
+void gather_tests();
 
 int main(){
-    srand(42);
+    const bool want_counters = std::getenv("JRD_PERF") != nullptr;
+    jrd::bench::perf_counters perf(want_counters);
+    if (perf.available()) counters = &perf;
+    else if (want_counters) std::cout << "hardware counters unavailable (" << perf.error() << "), timings only" << std::endl;
+
     iter_access_tests();
+    segment_access_tests();
     seq_access_tests();
     random_access_tests();
+    random_gap_tests();
     push_back_tests();
+    batch_append_tests();
+    reserve_tests();
+    policy_tests();
+    small_vector_tests();
+    snapshot_tests();
+    oscillation_tests();
+    gather_tests();
 }
 
 void iter_access_tests(){
@@ -64,6 +129,22 @@ void iter_access_tests(){
     iter_access(20, 500000);
 }
 
+void segment_access_tests(){
+    std::cout << "segment 1000 times" << std::endl;
+    segment_access(20, 1000);
+
+    std::cout << "segment 10000 times" << std::endl;
+    segment_access(20, 10000);
+
+    std::cout << "segment 100000 times" << std::endl;
+    segment_access(20, 100000);
+
+    std::cout << "segment 200000 times" << std::endl;
+    segment_access(20, 200000);
+
+    std::cout << "segment 500000 times" << std::endl;
+    segment_access(20, 500000);
+}
 
 void seq_access_tests(){
     std::cout << "seq 1000 times" << std::endl;
@@ -99,6 +180,94 @@ void random_access_tests(){
     random_access(20, 500000);
 }
 
+void random_gap_tests(){
+    std::cout << "random gap 10000 times" << std::endl;
+    random_gap(20, 10000);
+
+    std::cout << "random gap 100000 times" << std::endl;
+    random_gap(20, 100000);
+
+    std::cout << "random gap 1000000 times" << std::endl;
+    random_gap(20, 1000000);
+
+    std::cout << "random gap 10000000 times" << std::endl;
+    random_gap(20, 10000000);
+}
+
+void batch_append_tests(){
+    std::cout << "append 100000 in batches of 1000" << std::endl;
+    batch_append(20, 100000, 1000);
+
+    std::cout << "append 1000000 in batches of 1000" << std::endl;
+    batch_append(20, 1000000, 1000);
+
+    std::cout << "append 1000000 in batches of 100000" << std::endl;
+    batch_append(20, 1000000, 100000);
+}
+
+void reserve_tests(){
+    std::cout << "ingest 1000000 reserved" << std::endl;
+    reserved_ingest(10, 1000000);
+
+    std::cout << "ingest 10000000 reserved" << std::endl;
+    reserved_ingest(5, 10000000);
+}
+
+void policy_tests(){
+    std::cout << "growth policies 100000 elements" << std::endl;
+    policy_runner(20, 100000);
+
+    std::cout << "growth policies 1000000 elements" << std::endl;
+    policy_runner(20, 1000000);
+
+    std::cout << "growth policies 10000000 elements" << std::endl;
+    policy_runner(5, 10000000);
+}
+
+void small_vector_tests(){
+    std::cout << "100000 vectors of 0 elements" << std::endl;
+    small_vectors(100000, 0);
+
+    std::cout << "100000 vectors of 5 elements" << std::endl;
+    small_vectors(100000, 5);
+
+    std::cout << "100000 vectors of 16 elements" << std::endl;
+    small_vectors(100000, 16);
+
+    std::cout << "100000 vectors of 100 elements" << std::endl;
+    small_vectors(100000, 100);
+}
+
+void snapshot_tests(){
+    std::cout << "snapshot 1000000 elements" << std::endl;
+    snapshot_copy(20, 1000000);
+
+    std::cout << "snapshot 10000000 elements" << std::endl;
+    snapshot_copy(5, 10000000);
+
+    std::cout << "snapshot 100000000 elements" << std::endl;
+    snapshot_copy(3, 100000000);
+}
+
+void oscillation_tests(){
+    std::cout << "push/pop 1 across a block boundary 1000000 times" << std::endl;
+    oscillation(10, 65536, 1, 1000000);
+
+    std::cout << "push/pop 1000 across a block boundary 1000 times" << std::endl;
+    oscillation(10, 65536, 1000, 1000);
+
+    std::cout << "push/pop 100000 across a block boundary 100 times" << std::endl;
+    oscillation(10, 65536, 100000, 100);
+}
+
+void gather_tests(){
+    std::cout << "gather/scatter 1000000 of 1000000" << std::endl;
+    gather_access(20, 1000000);
+
+    std::cout << "gather/scatter 1000000 of 16777216" << std::endl;
+    gather_access(20, size_t(1) << 24);
+}
+
 void push_back_tests(){
     std::cout << "push_back 1000 times" << std::endl;
     test_runner(20, 1000);
@@ -120,39 +289,96 @@ void push_back_tests(){
 void random_access(size_t num_iterations, size_t num_append){
     timestamp_t t0;
     timestamp_t t1;
-    
+    const std::vector<size_t> idx = jrd::bench::index_stream(num_append, num_append);
+
     long double total = 0.0;
     for (size_t i = 0; i < num_iterations; ++i){
         jrd::vector<size_t> vec;
         jrd_vec_size_t(num_append, vec);
 
+        counters_start();
         t0 = get_timestamp();
-        jrd_vec_random(num_append, vec);
+        jrd_vec_random(idx, vec);
         t1 = get_timestamp();
+        counters_stop();
 
         total += (t1 - t0);
     }
 
     long double secs = (total / num_iterations) / 1000000.0L;
     std::cout << "jrd::vector<size_t> [] took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("jrd::vector<size_t> []", num_iterations * num_append);
 
     total = 0.0;
     for (size_t i = 0; i < num_iterations; ++i){
         std::vector<size_t> vec;
         std_vec_size_t(num_append, vec);
 
+        counters_start();
         t0 = get_timestamp();
-        std_vec_random(num_append, vec);
+        std_vec_random(idx, vec);
         t1 = get_timestamp();
+        counters_stop();
 
         total += (t1 - t0);
     }
 
     secs = (total / num_iterations) / 1000000.0L;
     std::cout << "std::vector<size_t> [] took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("std::vector<size_t> []", num_iterations * num_append);
 }
 
 
+// read only version of random_access, the two containers run interleaved
+// so they see the same machine state
+void random_gap(size_t num_iterations, size_t num_append){
+    timestamp_t t0;
+    timestamp_t t1;
+
+    const std::vector<size_t> idx = jrd::bench::index_stream(num_append, num_append);
+
+    jrd::vector<size_t> jvec;
+    jrd_vec_size_t(num_append, jvec);
+    std::vector<size_t> svec;
+    std_vec_size_t(num_append, svec);
+
+    size_t sink = 0;
+    long double jrd_total = 0.0;
+    long double std_total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        t0 = get_timestamp();
+        sink += jrd_vec_gather(idx, jvec);
+        t1 = get_timestamp();
+        jrd_total += (t1 - t0);
+
+        t0 = get_timestamp();
+        sink += std_vec_gather(idx, svec);
+        t1 = get_timestamp();
+        std_total += (t1 - t0);
+    }
+
+    long double jrd_secs = (jrd_total / num_iterations) / 1000000.0L;
+    long double std_secs = (std_total / num_iterations) / 1000000.0L;
+    std::cout << "jrd::vector<size_t> [] took: " << jrd_secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    std::cout << "std::vector<size_t> [] took: " << std_secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    if (std_total > 0) std::cout << "jrd / std: " << jrd_total / std_total << " (checksum " << sink << ")" << std::endl;
+
+    jrd_total = 0.0;
+    std_total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        t0 = get_timestamp();
+        sink += jrd_vec_chase(idx, jvec);
+        t1 = get_timestamp();
+        jrd_total += (t1 - t0);
+
+        t0 = get_timestamp();
+        sink += std_vec_chase(idx, svec);
+        t1 = get_timestamp();
+        std_total += (t1 - t0);
+    }
+    if (std_total > 0) std::cout << "jrd / std one access per call: " << jrd_total / std_total << " (checksum " << sink << ")" << std::endl;
+}
+
 void iter_access(size_t num_iterations, size_t num_append){
     timestamp_t t0;
     timestamp_t t1;
@@ -162,32 +388,72 @@ void iter_access(size_t num_iterations, size_t num_append){
         jrd::vector<size_t> vec;
         jrd_vec_size_t(num_append, vec);
 
+        counters_start();
         t0 = get_timestamp();
         jrd_vec_iter(num_append, vec);
         t1 = get_timestamp();
+        counters_stop();
 
         total += (t1 - t0);
     }
 
     long double secs = (total / num_iterations) / 1000000.0L;
     std::cout << "jrd::vector<size_t> iter took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("jrd::vector<size_t> iter", num_iterations * num_append);
 
     total = 0.0;
     for (size_t i = 0; i < num_iterations; ++i){
         std::vector<size_t> vec;
         std_vec_size_t(num_append, vec);
 
+        counters_start();
         t0 = get_timestamp();
         std_vec_iter(num_append, vec);
         t1 = get_timestamp();
+        counters_stop();
 
         total += (t1 - t0);
     }
 
     secs = (total / num_iterations) / 1000000.0L;
     std::cout << "std::vector<size_t> iter took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("std::vector<size_t> iter", num_iterations * num_append);
 }
 
+void segment_access(size_t num_iterations, size_t num_append){
+    timestamp_t t0;
+    timestamp_t t1;
+
+    long double total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        jrd::vector<size_t> vec;
+        jrd_vec_size_t(num_append, vec);
+
+        t0 = get_timestamp();
+        jrd_vec_segment(num_append, vec);
+        t1 = get_timestamp();
+
+        total += (t1 - t0);
+    }
+
+    long double secs = (total / num_iterations) / 1000000.0L;
+    std::cout << "jrd::vector<size_t> segment took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        std::vector<size_t> vec;
+        std_vec_size_t(num_append, vec);
+
+        t0 = get_timestamp();
+        std_vec_segment(num_append, vec);
+        t1 = get_timestamp();
+
+        total += (t1 - t0);
+    }
+
+    secs = (total / num_iterations) / 1000000.0L;
+    std::cout << "std::vector<size_t> segment took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+}
 
 void seq_access(size_t num_iterations, size_t num_append){
     timestamp_t t0;
@@ -198,30 +464,36 @@ void seq_access(size_t num_iterations, size_t num_append){
         jrd::vector<size_t> vec;
         jrd_vec_size_t(num_append, vec);
 
+        counters_start();
         t0 = get_timestamp();
         jrd_vec_seq(num_append, vec);
         t1 = get_timestamp();
+        counters_stop();
 
         total += (t1 - t0);
     }
 
     long double secs = (total / num_iterations) / 1000000.0L;
     std::cout << "jrd::vector<size_t> seq [] took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("jrd::vector<size_t> seq []", num_iterations * num_append);
 
     total = 0.0;
     for (size_t i = 0; i < num_iterations; ++i){
         std::vector<size_t> vec;
         std_vec_size_t(num_append, vec);
 
+        counters_start();
         t0 = get_timestamp();
         std_vec_seq(num_append, vec);
         t1 = get_timestamp();
+        counters_stop();
 
         total += (t1 - t0);
     }
 
     secs = (total / num_iterations) / 1000000.0L;
     std::cout << "std::vector<size_t> seq [] took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("std::vector<size_t> seq []", num_iterations * num_append);
 }
 
 void test_runner(size_t num_iterations, size_t num_append){
@@ -231,50 +503,62 @@ void test_runner(size_t num_iterations, size_t num_append){
     long double total = 0.0;
     for (size_t i = 0; i < num_iterations; ++i){
         jrd::vector<size_t> vec;
+        counters_start();
         t0 = get_timestamp();
         jrd_vec_size_t(num_append, vec);
         t1 = get_timestamp();
+        counters_stop();
         total += (t1 - t0);
     }
 
     long double secs = (total / num_iterations) / 1000000.0L;
     std::cout << "jrd::vector<size_t> took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("jrd::vector<size_t>", num_iterations * num_append);
 
     total = 0.0;
     for (size_t i = 0; i < num_iterations; ++i){
         std::vector<size_t> vec;
+        counters_start();
         t0 = get_timestamp();
         std_vec_size_t(num_append, vec);
         t1 = get_timestamp();
+        counters_stop();
         total += (t1 - t0);
     }
 
     secs = (total / num_iterations) / 1000000.0L;
     std::cout << "std::vector<size_t> took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("std::vector<size_t>", num_iterations * num_append);
 
     total = 0.0;
     for (size_t i = 0; i < num_iterations; ++i){
         jrd::vector<std::string> vec;
+        counters_start();
         t0 = get_timestamp();
         jrd_vec_str(num_append, vec);
         t1 = get_timestamp();
+        counters_stop();
         total += (t1 - t0);
     }
 
     secs = (total / num_iterations) / 1000000.0L;
     std::cout << "jrd::vector<string> took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("jrd::vector<string>", num_iterations * num_append);
 
     total = 0.0;
     for (size_t i = 0; i < num_iterations; ++i){
         std::vector<std::string> vec;
+        counters_start();
         t0 = get_timestamp();
         std_vec_str(num_append, vec);
         t1 = get_timestamp();
+        counters_stop();
         total += (t1 - t0);
     }
 
     secs = (total / num_iterations) / 1000000.0L;
     std::cout << "std::vector<string> took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+    report_counters("std::vector<string>", num_iterations * num_append);
 
 }
 
@@ -302,21 +586,62 @@ void std_vec_str(size_t num_iterations, std::vector<std::string> & vec){
 
 
 
-void jrd_vec_random(size_t num_iterations, jrd::vector<size_t> & vec){
-     for (size_t i = 0; i < num_iterations; ++i){
-         auto j = vec[static_cast<size_t>(rand()) % num_iterations];
+void jrd_vec_random(const std::vector<size_t> & idx, jrd::vector<size_t> & vec){
+     for (size_t i = 0; i < idx.size(); ++i){
+         auto j = vec[idx[i]];
          vec[i] = j;
      }
 }
 
-void std_vec_random(size_t num_iterations, std::vector<size_t> & vec){
-     for (size_t i = 0; i < num_iterations; ++i){
-         auto j = vec[static_cast<size_t>(rand()) % num_iterations];
+void std_vec_random(const std::vector<size_t> & idx, std::vector<size_t> & vec){
+     for (size_t i = 0; i < idx.size(); ++i){
+         auto j = vec[idx[i]];
          vec[i] = j;
      }
 }
 
 
+size_t jrd_vec_gather(const std::vector<size_t> & idx, const jrd::vector<size_t> & vec){
+    size_t sum = 0;
+    for (size_t i : idx){
+        sum += vec[i];
+    }
+    return sum;
+}
+
+size_t std_vec_gather(const std::vector<size_t> & idx, const std::vector<size_t> & vec){
+    size_t sum = 0;
+    for (size_t i : idx){
+        sum += vec[i];
+    }
+    return sum;
+}
+
+// one access per call, so nothing about the container can be hoisted out of the loop
+__attribute__((noinline)) size_t jrd_vec_get(const jrd::vector<size_t> & vec, size_t i){
+    return vec[i];
+}
+
+__attribute__((noinline)) size_t std_vec_get(const std::vector<size_t> & vec, size_t i){
+    return vec[i];
+}
+
+size_t jrd_vec_chase(const std::vector<size_t> & idx, const jrd::vector<size_t> & vec){
+    size_t sum = 0;
+    for (size_t i : idx){
+        sum += jrd_vec_get(vec, i);
+    }
+    return sum;
+}
+
+size_t std_vec_chase(const std::vector<size_t> & idx, const std::vector<size_t> & vec){
+    size_t sum = 0;
+    for (size_t i : idx){
+        sum += std_vec_get(vec, i);
+    }
+    return sum;
+}
+
 void jrd_vec_seq(size_t num_iterations, jrd::vector<size_t> & vec){
      for (size_t i = 0; i < num_iterations; ++i){
          auto j = vec[i];
@@ -332,18 +657,407 @@ void std_vec_seq(size_t num_iterations, std::vector<size_t> & vec){
 }
 
 void jrd_vec_iter(size_t num_iterations, jrd::vector<size_t> & vec){
-    // TODO
-     for (size_t i = 0; i < num_iterations; ++i){
-         auto j = vec[i];
-         vec[i] = j;
-     }
+    (void)num_iterations;
+    for (auto it = vec.begin(); it != vec.end(); ++it){
+        *it += 1;
+    }
 }
 
 void std_vec_iter(size_t num_iterations, std::vector<size_t> & vec){
-    // TODO
-     for (size_t i = 0; i < num_iterations; ++i){
-         auto j = vec[i];
-         vec[i] = j;
-     }
+    (void)num_iterations;
+    for (auto it = vec.begin(); it != vec.end(); ++it){
+        *it += 1;
+    }
 }
 
+void jrd_vec_segment(size_t num_iterations, jrd::vector<size_t> & vec){
+    (void)num_iterations;
+    vec.for_each_segment([](jrd::vector<size_t>::segment seg){
+        size_t * data = seg.data();
+        const size_t n = seg.size();
+        for (size_t i = 0; i < n; ++i){
+            data[i] += 1;
+        }
+    });
+}
+
+// std::vector is one segment
+void std_vec_segment(size_t num_iterations, std::vector<size_t> & vec){
+    (void)num_iterations;
+    size_t * data = vec.data();
+    const size_t n = vec.size();
+    for (size_t i = 0; i < n; ++i){
+        data[i] += 1;
+    }
+}
+
+
+/*
+ * ingest num_append records arriving in batches of batch, per element
+ * push_back against the bulk appends and std::vector::insert
+ */
+template <class Vec, class Append>
+void time_batches(const char * name, size_t num_iterations, size_t num_append, size_t batch, Append append){
+    long double total = 0.0;
+    size_t sink = 0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        Vec vec;
+        timestamp_t t0 = get_timestamp();
+        for (size_t done = 0; done < num_append; done += batch){
+            append(vec);
+        }
+        timestamp_t t1 = get_timestamp();
+        total += (t1 - t0);
+        sink += vec.size();
+    }
+    long double secs = (total / num_iterations) / 1000000.0L;
+    long double rate = (num_append / secs) / 1000000.0L;
+    std::cout << name << " took: " << secs << " seconds over " << num_iterations << " iterations, " << rate << " M records/s (" << sink << ")" << std::endl;
+}
+
+void batch_append(size_t num_iterations, size_t num_append, size_t batch){
+    std::vector<size_t> src(batch);
+    for (size_t i = 0; i < batch; ++i) src[i] = i;
+    std::vector<std::string> strs(batch);
+    for (size_t i = 0; i < batch; ++i) strs[i] = "some string " + std::to_string(i);
+
+    time_batches<jrd::vector<size_t>>("jrd::vector<size_t> push_back", num_iterations, num_append, batch, [&](jrd::vector<size_t> &vec){
+        for (size_t v : src) vec.push_back(v);
+    });
+    time_batches<jrd::vector<size_t>>("jrd::vector<size_t> append   ", num_iterations, num_append, batch, [&](jrd::vector<size_t> &vec){
+        vec.append(src.data(), src.size());
+    });
+    time_batches<jrd::vector<size_t>>("jrd::vector<size_t> grow_by  ", num_iterations, num_append, batch, [&](jrd::vector<size_t> &vec){
+        const size_t * p = src.data();
+        for (auto seg : vec.grow_by(src.size())){
+            std::copy(p, p + seg.size(), seg.begin());
+            p += seg.size();
+        }
+    });
+    time_batches<std::vector<size_t>>("std::vector<size_t> insert   ", num_iterations, num_append, batch, [&](std::vector<size_t> &vec){
+        vec.insert(vec.end(), src.begin(), src.end());
+    });
+
+    time_batches<jrd::vector<std::string>>("jrd::vector<string> push_back", num_iterations, num_append, batch, [&](jrd::vector<std::string> &vec){
+        for (const auto &v : strs) vec.push_back(v);
+    });
+    time_batches<jrd::vector<std::string>>("jrd::vector<string> append   ", num_iterations, num_append, batch, [&](jrd::vector<std::string> &vec){
+        vec.append(strs.begin(), strs.end());
+    });
+    time_batches<std::vector<std::string>>("std::vector<string> insert   ", num_iterations, num_append, batch, [&](std::vector<std::string> &vec){
+        vec.insert(vec.end(), strs.begin(), strs.end());
+    });
+}
+
+
+/*
+ * push_back in batches of 1000 and track the slowest batch, which is where
+ * block allocation and first touch page faults land without reserve()
+ */
+void reserved_ingest(size_t num_iterations, size_t num_append){
+    const size_t batch = 1000;
+    const char * names[] = {
+        "jrd::vector<size_t> no reserve      ",
+        "jrd::vector<size_t> reserve         ",
+        "jrd::vector<size_t> reserve prefault",
+    };
+    for (int mode = 0; mode < 3; ++mode){
+        long double total = 0.0;
+        long double setup = 0.0;
+        timestamp_t worst = 0;
+        for (size_t i = 0; i < num_iterations; ++i){
+            jrd::vector<size_t> vec;
+            timestamp_t t0 = get_timestamp();
+            if (mode > 0) vec.reserve(num_append, mode == 2);
+            timestamp_t t1 = get_timestamp();
+            setup += (t1 - t0);
+            for (size_t done = 0; done < num_append; done += batch){
+                timestamp_t b0 = get_timestamp();
+                for (size_t j = done; j < done + batch; ++j) vec.push_back(j);
+                timestamp_t b1 = get_timestamp();
+                total += (b1 - b0);
+                if (b1 - b0 > worst) worst = b1 - b0;
+            }
+        }
+        long double secs = (total / num_iterations) / 1000000.0L;
+        long double setup_secs = (setup / num_iterations) / 1000000.0L;
+        std::cout << names[mode] << " took: " << secs << " seconds over " << num_iterations << " iterations, reserve " << setup_secs << " seconds, worst batch " << worst << " us" << std::endl;
+    }
+}
+
+
+/*
+ * the same push_back, random read and segment sum runs for every growth
+ * policy, the random indices are drawn once and shared
+ */
+template <class Policy>
+void policy_bench(const char * name, size_t num_iterations, size_t num_append, const std::vector<size_t> & idx){
+    typedef jrd::vector<size_t, std::allocator<size_t>, Policy> vec_type;
+    long double push = 0.0;
+    long double gather = 0.0;
+    long double sum = 0.0;
+    size_t sink = 0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        vec_type vec;
+        timestamp_t t0 = get_timestamp();
+        for (size_t j = 0; j < num_append; ++j) vec.push_back(j);
+        timestamp_t t1 = get_timestamp();
+        for (size_t j : idx) sink += vec[j];
+        timestamp_t t2 = get_timestamp();
+        for (auto seg : vec.segments()){
+            for (size_t v : seg) sink += v;
+        }
+        timestamp_t t3 = get_timestamp();
+        push += (t1 - t0);
+        gather += (t2 - t1);
+        sum += (t3 - t2);
+    }
+    std::cout << name << " push_back took: " << (push / num_iterations) / 1000000.0L
+              << " random [] took: " << (gather / num_iterations) / 1000000.0L
+              << " segment sum took: " << (sum / num_iterations) / 1000000.0L
+              << " seconds over " << num_iterations << " iterations (" << sink % 10 << ")" << std::endl;
+}
+
+void policy_runner(size_t num_iterations, size_t num_append){
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<size_t> dist(0, num_append - 1);
+    std::vector<size_t> idx(num_append);
+    for (auto &j : idx) j = dist(rng);
+
+    policy_bench<jrd::doubling_growth<>>        ("doubling_growth<16>     ", num_iterations, num_append, idx);
+    policy_bench<jrd::doubling_growth<4096>>    ("doubling_growth<4096>   ", num_iterations, num_append, idx);
+    policy_bench<jrd::doubling_growth<16, 2>>   ("doubling_growth<16, 2>  ", num_iterations, num_append, idx);
+    policy_bench<jrd::doubling_growth<4096, 4>> ("doubling_growth<4096, 4>", num_iterations, num_append, idx);
+    policy_bench<jrd::fixed_growth<512>>        ("fixed_growth<512>       ", num_iterations, num_append, idx);
+    policy_bench<jrd::fixed_growth<4096>>       ("fixed_growth<4096>      ", num_iterations, num_append, idx);
+
+    long double push = 0.0;
+    long double gather = 0.0;
+    size_t sink = 0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        std::vector<size_t> vec;
+        timestamp_t t0 = get_timestamp();
+        for (size_t j = 0; j < num_append; ++j) vec.push_back(j);
+        timestamp_t t1 = get_timestamp();
+        for (size_t j : idx) sink += vec[j];
+        timestamp_t t2 = get_timestamp();
+        push += (t1 - t0);
+        gather += (t2 - t1);
+    }
+    std::cout << "std::vector<size_t>      push_back took: " << (push / num_iterations) / 1000000.0L
+              << " random [] took: " << (gather / num_iterations) / 1000000.0L
+              << " seconds over " << num_iterations << " iterations (" << sink % 10 << ")" << std::endl;
+}
+
+
+// std::allocator that keeps a running total of the bytes it has handed out
+static size_t heap_bytes = 0;
+
+template <typename T>
+struct tally_allocator : std::allocator<T> {
+    typedef T value_type;
+    template <typename U> struct rebind { typedef tally_allocator<U> other; };
+
+    tally_allocator() noexcept {}
+    template <typename U>
+    tally_allocator(const tally_allocator<U> &) noexcept {}
+
+    T * allocate(size_t n) {
+        heap_bytes += n * sizeof(T);
+        return std::allocator<T>::allocate(n);
+    }
+    void deallocate(T * p, size_t n) {
+        heap_bytes -= n * sizeof(T);
+        std::allocator<T>::deallocate(p, n);
+    }
+};
+
+/*
+ * constructs num_vectors vectors holding num_append elements each, then
+ * destroys them, and reports the object size plus the heap bytes each
+ * one held while alive
+ */
+template <class Vec>
+void small_vector_bench(const char * name, size_t num_vectors, size_t num_append){
+    std::allocator<Vec> raw;
+    Vec * vecs = raw.allocate(num_vectors);
+    // fault the array in first so only construction is timed
+    std::memset(static_cast<void *>(vecs), 0, num_vectors * sizeof(Vec));
+    timestamp_t t0 = get_timestamp();
+    for (size_t i = 0; i < num_vectors; ++i){
+        ::new (static_cast<void *>(vecs + i)) Vec();
+        for (size_t j = 0; j < num_append; ++j) vecs[i].push_back(j);
+    }
+    timestamp_t t1 = get_timestamp();
+    const size_t held = heap_bytes;
+    for (size_t i = 0; i < num_vectors; ++i){
+        vecs[i].~Vec();
+    }
+    timestamp_t t2 = get_timestamp();
+    raw.deallocate(vecs, num_vectors);
+
+    long double build = (static_cast<long double>(t1 - t0) / num_vectors) * 1000.0L;
+    long double destroy = (static_cast<long double>(t2 - t1) / num_vectors) * 1000.0L;
+    std::cout << name << " construct took: " << build << " ns destroy took: " << destroy << " ns per vector, sizeof "
+              << sizeof(Vec) << " + heap " << held / num_vectors << " bytes per vector" << std::endl;
+}
+
+void small_vectors(size_t num_vectors, size_t num_append){
+    small_vector_bench<jrd::vector<size_t, tally_allocator<size_t>>>("jrd::vector<size_t>                   ", num_vectors, num_append);
+    small_vector_bench<jrd::vector<size_t, tally_allocator<size_t>, jrd::inline_first_block<>>>("jrd::vector<size_t> inline_first_block", num_vectors, num_append);
+    small_vector_bench<jrd::vector<size_t, tally_allocator<size_t>, jrd::fixed_growth<16>>>("jrd::vector<size_t> fixed_growth<16>  ", num_vectors, num_append);
+    small_vector_bench<std::vector<size_t, tally_allocator<size_t>>>("std::vector<size_t>                   ", num_vectors, num_append);
+}
+
+
+/*
+ * what a background reporter needs: a consistent copy of the vector. The
+ * snapshot shares the full blocks, the deep copies move every element.
+ * The first write after a snapshot pays for cloning the block it lands
+ * in, shown for the first and the largest full block
+ */
+void snapshot_copy(size_t num_iterations, size_t num_append){
+    jrd::vector<size_t> vec;
+    for (size_t i = 0; i < num_append; ++i) vec.push_back(i);
+    const jrd::vector<size_t> & cvec = vec;
+    const size_t last_full = jrd::doubling_growth<>::block_start(jrd::doubling_growth<>::locate(num_append - 1).block) - 1;
+
+    long double snap = 0.0;
+    long double first_write = 0.0;
+    long double big_write = 0.0;
+    size_t sink = 0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        timestamp_t t0 = get_timestamp();
+        jrd::vector<size_t> copy = vec.snapshot();
+        timestamp_t t1 = get_timestamp();
+        vec[0] += 1;
+        timestamp_t t2 = get_timestamp();
+        vec[last_full] += 1;
+        timestamp_t t3 = get_timestamp();
+        snap += (t1 - t0);
+        first_write += (t2 - t1);
+        big_write += (t3 - t2);
+        sink += copy.size();
+    }
+    std::cout << "jrd::vector<size_t> snapshot        took: " << (snap / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations (" << sink % 10 << ")" << std::endl;
+    std::cout << "jrd::vector<size_t> write block 0   took: " << (first_write / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations" << std::endl;
+    std::cout << "jrd::vector<size_t> write last full took: " << (big_write / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    long double total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        timestamp_t t0 = get_timestamp();
+        jrd::vector<size_t> copy;
+        copy.append(cvec.begin(), cvec.end());
+        timestamp_t t1 = get_timestamp();
+        total += (t1 - t0);
+        sink += copy.size();
+    }
+    std::cout << "jrd::vector<size_t> deep copy       took: " << (total / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations (" << sink % 10 << ")" << std::endl;
+    vec.clear();
+
+    std::vector<size_t> stdvec(num_append);
+    for (size_t i = 0; i < num_append; ++i) stdvec[i] = i;
+    total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        timestamp_t t0 = get_timestamp();
+        std::vector<size_t> copy(stdvec);
+        timestamp_t t1 = get_timestamp();
+        total += (t1 - t0);
+        sink += copy.size();
+    }
+    std::cout << "std::vector<size_t> copy            took: " << (total / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations (" << sink % 10 << ")" << std::endl;
+}
+
+
+/*
+ * a stack sitting on a block boundary, each cycle pushes burst elements
+ * and pops them again. The shrink variant frees every emptied block at
+ * once, which is what pop_back would cost without the spare block
+ */
+template <class Stack, class Pop>
+long double time_oscillation(size_t num_iterations, size_t base, size_t burst, size_t cycles, Pop pop){
+    long double total = 0.0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        Stack stack;
+        for (size_t j = 0; j < base; ++j) stack.push_back(j);
+        timestamp_t t0 = get_timestamp();
+        for (size_t c = 0; c < cycles; ++c){
+            for (size_t j = 0; j < burst; ++j) stack.push_back(j);
+            for (size_t j = 0; j < burst; ++j) pop(stack);
+        }
+        timestamp_t t1 = get_timestamp();
+        total += (t1 - t0);
+        assert(stack.size() == base);
+    }
+    return (total / num_iterations) / 1000000.0L;
+}
+
+void oscillation(size_t num_iterations, size_t base, size_t burst, size_t cycles){
+    long double secs = time_oscillation<jrd::vector<size_t>>(num_iterations, base, burst, cycles, [](jrd::vector<size_t> &v){ v.pop_back(); });
+    std::cout << "jrd::vector<size_t> pop_back         took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    secs = time_oscillation<jrd::vector<size_t>>(num_iterations, base, burst, cycles, [](jrd::vector<size_t> &v){ v.pop_back(); v.shrink_to_fit(); });
+    std::cout << "jrd::vector<size_t> pop + shrink     took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    secs = time_oscillation<std::vector<size_t>>(num_iterations, base, burst, cycles, [](std::vector<size_t> &v){ v.pop_back(); });
+    std::cout << "std::vector<size_t> pop_back         took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+
+    secs = time_oscillation<std::deque<size_t>>(num_iterations, base, burst, cycles, [](std::deque<size_t> &v){ v.pop_back(); });
+    std::cout << "std::deque<size_t> pop_back          took: " << secs << " seconds over " << num_iterations << " iterations" << std::endl;
+}
+
+
+/*
+ * a million random reads and writes through [] one at a time against
+ * gather() and scatter(), which decode and prefetch the indices ahead
+ */
+void gather_access(size_t num_iterations, size_t num_append){
+    const size_t num_access = 1000000;
+    const std::vector<size_t> idx = jrd::bench::index_stream(num_access, num_append);
+    std::vector<size_t> out(num_access);
+
+    jrd::vector<size_t> jvec;
+    jrd_vec_size_t(num_append, jvec);
+    std::vector<size_t> svec;
+    std_vec_size_t(num_append, svec);
+
+    long double totals[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    size_t sink = 0;
+    for (size_t i = 0; i < num_iterations; ++i){
+        timestamp_t t0 = get_timestamp();
+        for (size_t k = 0; k < num_access; ++k) out[k] = svec[idx[k]];
+        timestamp_t t1 = get_timestamp();
+        for (size_t k = 0; k < num_access; ++k) out[k] = jvec[idx[k]];
+        timestamp_t t2 = get_timestamp();
+        jvec.gather(idx.data(), num_access, out.data());
+        timestamp_t t3 = get_timestamp();
+        sink += out[i];
+
+        for (size_t k = 0; k < num_access; ++k) svec[idx[k]] = out[k];
+        timestamp_t t4 = get_timestamp();
+        for (size_t k = 0; k < num_access; ++k) jvec[idx[k]] = out[k];
+        timestamp_t t5 = get_timestamp();
+        jvec.scatter(idx.data(), num_access, out.data());
+        timestamp_t t6 = get_timestamp();
+
+        totals[0] += (t1 - t0);
+        totals[1] += (t2 - t1);
+        totals[2] += (t3 - t2);
+        totals[3] += (t4 - t3);
+        totals[4] += (t5 - t4);
+        totals[5] += (t6 - t5);
+    }
+
+    const char * names[6] = {
+        "std::vector<size_t> [] read   ",
+        "jrd::vector<size_t> [] read   ",
+        "jrd::vector<size_t> gather    ",
+        "std::vector<size_t> [] write  ",
+        "jrd::vector<size_t> [] write  ",
+        "jrd::vector<size_t> scatter   ",
+    };
+    for (size_t m = 0; m < 6; ++m){
+        std::cout << names[m] << " took: " << (totals[m] / num_iterations) / 1000000.0L << " seconds over " << num_iterations << " iterations" << std::endl;
+    }
+    std::cout << "(" << sink % 10 << ")" << std::endl;
+}